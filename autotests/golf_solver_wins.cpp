@@ -21,6 +21,9 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
  * OTHER DEALINGS IN THE SOFTWARE.
  */
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QProcess>
 #include <QRegularExpression>
 #include <QTest>
@@ -30,6 +33,8 @@ class TestSolver: public QObject
     Q_OBJECT
 private Q_SLOTS:
     void runSolver();
+    void runSolverJobs();
+    void runSolverStats();
 };
 
 void TestSolver::runSolver()
@@ -43,5 +48,35 @@ void TestSolver::runSolver()
     QCOMPARE(QRegularExpression("\\n2 won \\(").match(QString(bytes)).hasMatch(), true);
 }
 
+void TestSolver::runSolverJobs()
+{
+    QProcess kpat;
+    kpat.start(QStringLiteral("../bin/kpat"), QStringList() << QStringLiteral("--start") << "1" << QStringLiteral("--end") << "6" << QStringLiteral("--jobs") << "3" << QStringLiteral("--solve") << QStringLiteral("Golf"));
+    QCOMPARE(kpat.waitForFinished(), true);
+    QCOMPARE(kpat.exitStatus(), QProcess::NormalExit);
+    QCOMPARE(kpat.exitCode(), 0);
+    auto bytes = kpat.readAllStandardOutput();
+    // Results come back in deal order no matter which worker finished first.
+    QCOMPARE(QRegularExpression("^1 \\w+ \\(.*\\n2 won \\(.*\\n3 .*\\n4 .*\\n5 .*\\n6 .*\\n").match(QString(bytes)).hasMatch(), true);
+    QCOMPARE(QRegularExpression("\\n6 deals in \\d+ ms with 3 jobs").match(QString(bytes)).hasMatch(), true);
+    QCOMPARE(QRegularExpression("\\npeak memory \\d+ KB\\n").match(QString(bytes)).hasMatch(), true);
+}
+
+void TestSolver::runSolverStats()
+{
+    QProcess kpat;
+    kpat.start(QStringLiteral("../bin/kpat"), QStringList() << QStringLiteral("--start") << "1" << QStringLiteral("--end") << "3" << QStringLiteral("--stats") << QStringLiteral("--solve") << QStringLiteral("Golf"));
+    QCOMPARE(kpat.waitForFinished(), true);
+    QCOMPARE(kpat.exitStatus(), QProcess::NormalExit);
+    QCOMPARE(kpat.exitCode(), 0);
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(kpat.readAllStandardOutput(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    const QJsonArray deals = doc.object().value(QStringLiteral("deals")).toArray();
+    QCOMPARE(deals.count(), 3);
+    QCOMPARE(deals.at(1).toObject().value(QStringLiteral("deal")).toInt(), 2);
+    QCOMPARE(deals.at(1).toObject().value(QStringLiteral("status")).toString(), QStringLiteral("won"));
+}
+
 QTEST_MAIN(TestSolver)
 #include "golf_solver_wins.moc"
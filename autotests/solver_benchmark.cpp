@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Times the patsolve engine on games with long piles.  Run with
+// -iterations N or -tickcounter for steadier numbers.  The Mod3 benchmarks
+// also print how many unique positions fit in a megabyte, with and without
+// compact positions.
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+class TestSolverBenchmark: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void benchmarkSpider();
+    void benchmarkFortyeight();
+    void benchmarkMod3();
+    void benchmarkMod3Compact();
+};
+
+namespace
+{
+constexpr int firstDeal = 1;
+constexpr int numDeals = 3;
+constexpr int maxPositions = 100000;
+
+// Returns the unique positions per megabyte of solver memory.
+double solveDeals( DealerScene *d )
+{
+    double positions = 0, bytes = 0;
+    for ( int i = firstDeal; i < firstDeal + numDeals; ++i )
+    {
+        dealGame( d, i );
+        d->solver()->patsolve( maxPositions );
+        positions += d->solver()->stats().positions;
+        bytes += d->solver()->stats().peakMemory;
+    }
+    return bytes > 0 ? positions / ( bytes / 1e6 ) : 0;
+}
+
+void benchmarkMod3( bool compact )
+{
+    DealerScene *d = getDealer( DealerInfo::Mod3Id );
+    QVERIFY( d );
+    d->solver()->setCompactPositions( compact );
+    double perMB = 0;
+    QBENCHMARK {
+        perMB = solveDeals( d );
+    }
+    qInfo( "%s positions: %.0f unique positions per MB",
+           compact ? "compact" : "full", perMB );
+    delete d;
+}
+}
+
+void TestSolverBenchmark::benchmarkSpider()
+{
+    DealerScene *d = getDealer( DealerInfo::SpiderOneSuitId );
+    QVERIFY( d );
+    QBENCHMARK {
+        solveDeals( d );
+    }
+    delete d;
+}
+
+void TestSolverBenchmark::benchmarkFortyeight()
+{
+    DealerScene *d = getDealer( DealerInfo::FortyAndEightId );
+    QVERIFY( d );
+    QBENCHMARK {
+        solveDeals( d );
+    }
+    delete d;
+}
+
+void TestSolverBenchmark::benchmarkMod3()
+{
+    benchmarkMod3( false );
+}
+
+void TestSolverBenchmark::benchmarkMod3Compact()
+{
+    benchmarkMod3( true );
+}
+
+QTEST_MAIN(TestSolverBenchmark)
+#include "solver_benchmark.moc"
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checks that a search stops at its deadline or time limit, with one
+// thread or several, and that the next search is not held up by it.
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+
+class TestSolverDeadline: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void solverDeadline_stop();
+    void solverDeadline_expired();
+};
+
+namespace
+{
+// Klondike deals branch enough to keep several threads busy, and the cap
+// turns the ones that take long into quick MemoryLimitReached results.
+constexpr int firstDeal = 1;
+constexpr int numDeals = 12;
+constexpr int maxPositions = 20000;
+}
+
+void TestSolverDeadline::solverDeadline_stop()
+{
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        solver->setThreads( 1 );
+        const int expected = solver->patsolve( maxPositions );
+
+        // A deadline that has passed already stops the search within its
+        // first moves, and so does a time limit of nothing; only the
+        // quickest deals still get their result.
+        for ( int threads : { 1, 4 } )
+        {
+            solver->translate_layout();
+            solver->setThreads( threads );
+            solver->setDeadline( QDeadlineTimer( 0 ) );
+            int status = solver->patsolve( maxPositions );
+            QVERIFY( status == SolverInterface::DeadlineReached || status == expected );
+            QCOMPARE( solver->stats().status, status );
+
+            solver->translate_layout();
+            solver->setDeadline( QDeadlineTimer( QDeadlineTimer::Forever ) );
+            solver->setTimeLimit( 0 );
+            status = solver->patsolve( maxPositions );
+            QVERIFY( status == SolverInterface::DeadlineReached || status == expected );
+            solver->setTimeLimit( -1 );
+        }
+
+        solver->translate_layout();
+        solver->setThreads( 1 );
+        QCOMPARE( int( solver->patsolve( maxPositions ) ), expected );
+    }
+}
+
+void TestSolverDeadline::solverDeadline_expired()
+{
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+
+    // The deal that takes the longest search; nothing stops that one
+    // before the first poll of the clock.
+    int deal = firstDeal;
+    unsigned long positions = 0;
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        solver->patsolve( maxPositions );
+        if ( solver->stats().positions > positions )
+        {
+            deal = firstDeal + i;
+            positions = solver->stats().positions;
+        }
+    }
+    QVERIFY( positions > 4000 );
+
+    // Either way of running out of time stops it within its first few
+    // hundred positions, with one thread or several.
+    for ( int threads : { 1, 4 } )
+    {
+        solver->setThreads( threads );
+
+        dealGame( dealer.get(), deal );
+        solver->setDeadline( QDeadlineTimer( 0 ) );
+        QCOMPARE( int( solver->patsolve( maxPositions ) ), int( SolverInterface::DeadlineReached ) );
+        solver->setDeadline( QDeadlineTimer( QDeadlineTimer::Forever ) );
+        QCOMPARE( solver->stats().status, SolverInterface::DeadlineReached );
+        QVERIFY( solver->stats().positions < positions / 4 );
+        QVERIFY( solver->winMoves().isEmpty() );
+
+        // This goes on with the search stopped above; stats() counts both.
+        solver->translate_layout();
+        solver->setTimeLimit( 0 );
+        QCOMPARE( int( solver->patsolve( maxPositions ) ), int( SolverInterface::DeadlineReached ) );
+        solver->setTimeLimit( -1 );
+        QVERIFY( solver->stats().positions < positions / 4 );
+    }
+}
+
+QTEST_MAIN(TestSolverDeadline)
+#include "solver_deadline.moc"
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checks that the dedicated search of Aces Up comes to the same
+// conclusions as the general one.
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+
+class TestSolverDedicated: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void solverDedicated_acesUp();
+};
+
+namespace
+{
+// Aces Up deals are cheap enough to solve a dozen of them, and the
+// cap turns the unsolvable ones into quick MemoryLimitReached results.
+constexpr int firstDeal = 1;
+constexpr int numDeals = 12;
+constexpr int maxPositions = 50000;
+}
+
+void TestSolverDedicated::solverDedicated_acesUp()
+{
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::AcesUpId ) );
+    std::unique_ptr<DealerScene> other( getDealer( DealerInfo::AcesUpId ) );
+    QVERIFY( dealer );
+    QVERIFY( other );
+
+    // Threads are left to the general search.
+    SolverInterface *dedicated = other->solver();
+    dedicated->setDedicatedSearch( true );
+    dedicated->setThreads( 4 );
+
+    int concluded = 0;
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        dealGame( other.get(), firstDeal + i );
+        const int expected = dealer->solver()->patsolve( maxPositions );
+
+        // The searches go about it in another order, so they may find
+        // other solutions, or run into the cap at other deals.
+        const int status = dedicated->patsolve( maxPositions );
+        QCOMPARE( dedicated->stats().status, status );
+        QCOMPARE( dedicated->winMoves().isEmpty(), status != SolverInterface::SolutionExists );
+        if ( status != SolverInterface::SolutionExists && status != SolverInterface::NoSolutionExists )
+            continue;
+        ++concluded;
+        if ( expected == SolverInterface::SolutionExists || expected == SolverInterface::NoSolutionExists )
+            QCOMPARE( status, expected );
+    }
+    QVERIFY( concluded > 0 );
+}
+
+QTEST_MAIN(TestSolverDedicated)
+#include "solver_dedicated.moc"
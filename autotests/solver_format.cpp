@@ -38,7 +38,7 @@
 #include "dealer.h"
 #include "dealerinfo.h"
 #include "golf.h"
-#include "../kpat_debug.h"
+#include "solver_helpers.h"
 
 #include <cassert>
 
@@ -49,31 +49,6 @@ private Q_SLOTS:
     void solverFormat_deal1();
 };
 
-static DealerScene *getDealer( int wanted_game )
-{
-    fprintf(stderr, "diuuuuu=\n");
-    const auto games = DealerInfoList::self()->games();
-    for (DealerInfo * di : games) {
-        fprintf(stderr, "di=%p\n", di);
-        if ( di->providesId( wanted_game ) )
-        {
-            DealerScene * d = di->createGame();
-            Q_ASSERT( d );
-            d->setDeck( new KCardDeck( KCardTheme(), d ) );
-            d->initialize();
-
-            if ( !d->solver() )
-            {
-                qCCritical(KPAT_LOG) << "There is no solver for" << di->nameForId( wanted_game );;
-                return nullptr;
-            }
-
-            return d;
-        }
-    }
-    return nullptr;
-}
-
 void TestSolverFormat::solverFormat_deal1()
 {
     DealerScene *f = getDealer( DealerInfo::GolfId  );
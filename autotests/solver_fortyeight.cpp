@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checks the Forty & Eight solver.  This test is built with HASHPILE_DEBUG,
+// so sums of a tableau pile that fall out of step with its cards, after a
+// move, its undo or unpacking a position, stop it.
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+
+class TestSolverFortyeight: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void solverFortyeight_pileSums();
+};
+
+namespace
+{
+constexpr int firstDeal = 1;
+constexpr int numDeals = 10;
+constexpr int maxPositions = 20000;
+}
+
+void TestSolverFortyeight::solverFortyeight_pileSums()
+{
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::FortyAndEightId ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+
+    // Few deals are decided within the cap; what counts is that the
+    // searches get through their moves.
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        const SearchResult result = solve( solver, maxPositions );
+        QCOMPARE( result.winMoves.isEmpty(), result.status != SolverInterface::SolutionExists );
+        QVERIFY( solver->stats().moves > 0 );
+    }
+}
+
+QTEST_MAIN(TestSolverFortyeight)
+#include "solver_fortyeight.moc"
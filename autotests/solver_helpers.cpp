@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "solver_helpers.h"
+
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "../kpat_debug.h"
+
+DealerScene *getDealer( int wanted_game )
+{
+    const auto games = DealerInfoList::self()->games();
+    for (DealerInfo * di : games) {
+        if ( di->providesId( wanted_game ) )
+        {
+            DealerScene * d = di->createGame();
+            Q_ASSERT( d );
+            d->setDeck( new KCardDeck( KCardTheme(), d ) );
+            d->initialize();
+            d->mapOldId( wanted_game );
+
+            if ( !d->solver() )
+            {
+                qCCritical(KPAT_LOG) << "There is no solver for" << di->nameForId( wanted_game );
+                delete d;
+                return nullptr;
+            }
+
+            return d;
+        }
+    }
+    return nullptr;
+}
+
+void dealGame( DealerScene *d, int deal )
+{
+    d->deck()->stopAnimations();
+    d->startNew( deal );
+    d->solver()->translate_layout();
+}
+
+SearchResult solve( SolverInterface *solver, int max_positions )
+{
+    SearchResult result;
+    result.status = solver->patsolve( max_positions );
+    result.winMoves = solver->winMoves();
+    return result;
+}
+
+void compareResults( const SearchResult &have, const SearchResult &want )
+{
+    QCOMPARE( have.status, want.status );
+    QCOMPARE( have.winMoves.count(), want.winMoves.count() );
+    for ( int i = 0; i < want.winMoves.count(); ++i )
+    {
+        QCOMPARE( have.winMoves[i].card_index, want.winMoves[i].card_index );
+        QCOMPARE( have.winMoves[i].from, want.winMoves[i].from );
+        QCOMPARE( have.winMoves[i].to, want.winMoves[i].to );
+        QCOMPARE( have.winMoves[i].totype, want.winMoves[i].totype );
+    }
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOLVER_HELPERS_H
+#define SOLVER_HELPERS_H
+
+#include "patsolve/solverinterface.h"
+
+#include <QList>
+
+class DealerScene;
+
+// Returns a scene of the game with the given id, set up as for playing
+// it, or null if there is no such game or it has no solver.
+DealerScene *getDealer( int wanted_game );
+
+// Deals the given deal and hands it to the scene's solver.
+void dealGame( DealerScene *d, int deal );
+
+// What a search came to.
+struct SearchResult
+{
+    int status;
+    QList<MOVE> winMoves;
+};
+
+SearchResult solve( SolverInterface *solver, int max_positions );
+
+// Compares status and solution, failing the current test if they differ.
+void compareResults( const SearchResult &have, const SearchResult &want );
+
+#endif
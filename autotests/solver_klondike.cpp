@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checks the Klondike solver.  This test is built with HASHPILE_DEBUG, so
+// a pile hash that falls out of step with its cards stops it.
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+
+class TestSolverKlondike: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void solverKlondike_talonHash_data();
+    void solverKlondike_talonHash();
+};
+
+namespace
+{
+constexpr int firstDeal = 1;
+constexpr int numDeals = 10;
+constexpr int maxPositions = 20000;
+}
+
+void TestSolverKlondike::solverKlondike_talonHash_data()
+{
+    QTest::addColumn<int>( "game" );
+    QTest::newRow( "draw one" ) << int( DealerInfo::KlondikeDrawOneId );
+    QTest::newRow( "draw three" ) << int( DealerInfo::KlondikeDrawThreeId );
+}
+
+void TestSolverKlondike::solverKlondike_talonHash()
+{
+    QFETCH( int, game );
+    std::unique_ptr<DealerScene> dealer( getDealer( game ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+
+    // Playing a card from the waste takes it from the middle of the
+    // talon, which holds the stock as well, and every search does that
+    // while the stock still has cards.
+    int won = 0;
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        const SearchResult result = solve( solver, maxPositions );
+        QCOMPARE( result.winMoves.isEmpty(), result.status != SolverInterface::SolutionExists );
+        if ( result.status == SolverInterface::SolutionExists )
+            ++won;
+    }
+    QVERIFY( won > 0 );
+}
+
+QTEST_MAIN(TestSolverKlondike)
+#include "solver_klondike.moc"
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checks the quick look at a Klondike or Yukon layout that takes a deal
+// for lost before searching it: it has to catch the dead deals below, and
+// must never take a deal that can be won for one.
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+
+class TestSolverRefuted: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void solverRefuted_data();
+    void solverRefuted();
+};
+
+namespace
+{
+// Enough for every winnable deal below to be won.
+constexpr int maxPositions = 20000;
+
+const QList<int> klondikeDead = { 9, 12, 57, 119, 221 };
+const QList<int> klondikeWon = { 1, 2, 3, 4, 5, 6, 10, 11, 13, 15, 16, 17 };
+const QList<int> yukonDead = { 105, 151, 153, 208, 285 };
+const QList<int> yukonWon = { 1, 2, 3, 9, 10, 11, 13, 14, 15, 18, 21, 22 };
+
+void addRows( const char *name, int game, const QList<int> &deals, bool dead )
+{
+    for ( int deal : deals )
+        QTest::newRow( QByteArray( name ).append( ' ' ).append( QByteArray::number( deal ) ).constData() )
+            << game << deal << dead;
+}
+}
+
+void TestSolverRefuted::solverRefuted_data()
+{
+    QTest::addColumn<int>( "game" );
+    QTest::addColumn<int>( "deal" );
+    QTest::addColumn<bool>( "dead" );
+
+    addRows( "klondike", DealerInfo::KlondikeDrawOneId, klondikeDead, true );
+    addRows( "klondike", DealerInfo::KlondikeDrawOneId, klondikeWon, false );
+    addRows( "yukon", DealerInfo::YukonId, yukonDead, true );
+    addRows( "yukon", DealerInfo::YukonId, yukonWon, false );
+}
+
+void TestSolverRefuted::solverRefuted()
+{
+    QFETCH( int, game );
+    QFETCH( int, deal );
+    QFETCH( bool, dead );
+    std::unique_ptr<DealerScene> dealer( getDealer( game ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+
+    dealGame( dealer.get(), deal );
+    const SearchResult result = solve( solver, maxPositions );
+    if ( dead )
+    {
+        QCOMPARE( result.status, int( SolverInterface::NoSolutionExists ) );
+        QVERIFY( solver->stats().refuted );
+    }
+    else
+    {
+        QCOMPARE( result.status, int( SolverInterface::SolutionExists ) );
+        QVERIFY( !solver->stats().refuted );
+    }
+}
+
+QTEST_MAIN(TestSolverRefuted)
+#include "solver_refuted.moc"
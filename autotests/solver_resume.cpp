@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Stops searches over and over and checks that going on with them, in
+// the same solver or from a checkpoint file in another one, ends up where
+// a single search does.
+#include <QTemporaryDir>
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+#include <utility>
+
+class TestSolverResume: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void solverResume_sameSolver();
+    void solverResume_checkpoint();
+    void solverResume_afterIsGameLost_data();
+    void solverResume_afterIsGameLost();
+};
+
+namespace
+{
+// Klondike deals branch enough to keep several threads busy, and the cap
+// turns the ones that take long into quick MemoryLimitReached results.
+constexpr int firstDeal = 1;
+constexpr int numDeals = 12;
+constexpr int maxPositions = 20000;
+
+// More than any game asks isGameLost() to look at.
+constexpr unsigned long manyPositions = 1000;
+}
+
+void TestSolverResume::solverResume_sameSolver()
+{
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+    solver->setThreads( 1 );
+
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        const SearchResult expected = solve( solver, maxPositions );
+        const unsigned long positions = solver->stats().positions;
+
+        // Searching a few positions at a time, every patsolve() goes on
+        // where the last one stopped, so together they do exactly what a
+        // single one does.
+        SearchResult have;
+        solver->setTimeLimit( 0 );
+        do
+        {
+            solver->translate_layout();
+            have.status = solver->patsolve( maxPositions );
+        } while ( have.status == SolverInterface::DeadlineReached );
+        solver->setTimeLimit( -1 );
+        have.winMoves = solver->winMoves();
+        compareResults( have, expected );
+        QCOMPARE( solver->stats().positions, positions );
+    }
+}
+
+void TestSolverResume::solverResume_checkpoint()
+{
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    std::unique_ptr<DealerScene> other( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    QVERIFY( dealer );
+    QVERIFY( other );
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QString file = dir.filePath( QStringLiteral("search") );
+
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        dealGame( other.get(), firstDeal + i );
+        SolverInterface *from = dealer->solver();
+        SolverInterface *to = other->solver();
+
+        const SearchResult expected = solve( from, maxPositions );
+        const unsigned long positions = from->stats().positions;
+
+        // Every time the search stops, it is saved and goes on in the
+        // other solver, as it would in another process.
+        SearchResult have;
+        from->setTimeLimit( 0 );
+        to->setTimeLimit( 0 );
+        from->translate_layout();
+        have.status = from->patsolve( maxPositions );
+        while ( have.status == SolverInterface::DeadlineReached )
+        {
+            QVERIFY( from->saveCheckpoint( file ) );
+            QVERIFY( to->loadCheckpoint( file ) );
+            std::swap( from, to );
+            from->translate_layout();
+            have.status = from->patsolve( maxPositions );
+        }
+        from->setTimeLimit( -1 );
+        to->setTimeLimit( -1 );
+        have.winMoves = from->winMoves();
+        compareResults( have, expected );
+        QCOMPARE( from->stats().positions, positions );
+        QVERIFY( !from->saveCheckpoint( file ) );
+    }
+}
+
+void TestSolverResume::solverResume_afterIsGameLost_data()
+{
+    QTest::addColumn<int>( "threads" );
+    QTest::newRow( "one thread" ) << 1;
+    QTest::newRow( "four threads" ) << 4;
+}
+
+void TestSolverResume::solverResume_afterIsGameLost()
+{
+    QFETCH( int, threads );
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+
+    int resumed = 0;
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+
+        // Stop a search the way the background one is stopped, once it
+        // has seen more positions than isGameLost() looks at.
+        solver->setThreads( threads );
+        solver->setTimeLimit( 0 );
+        SolverInterface::ExitStatus status;
+        do
+        {
+            solver->translate_layout();
+            status = solver->patsolve();
+        } while ( status == SolverInterface::DeadlineReached && solver->stats().positions <= manyPositions );
+        if ( status != SolverInterface::DeadlineReached )
+            continue;
+        const unsigned long positions = solver->stats().positions;
+
+        // isGameLost() searches with its own settings, and must leave the
+        // stopped search to the next background search, which goes on
+        // with it instead of starting over.
+        QVERIFY( !dealer->isGameLost() );
+        solver->setThreads( threads );
+        solver->setTimeLimit( 0 );
+        solver->translate_layout();
+        solver->patsolve();
+        QVERIFY( solver->stats().positions >= positions );
+        solver->setTimeLimit( -1 );
+        ++resumed;
+    }
+    QVERIFY( resumed > 0 );
+}
+
+QTEST_MAIN(TestSolverResume)
+#include "solver_resume.moc"
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Gives a search so little memory that its seen positions go to disk,
+// and checks that it still searches as it would without.
+#include <QDir>
+#include <QTemporaryDir>
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+
+class TestSolverSpill: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void solverSpill_matchInMemory();
+};
+
+namespace
+{
+// Klondike deals branch enough to keep several threads busy, and the cap
+// turns the ones that take long into quick MemoryLimitReached results.
+constexpr int firstDeal = 1;
+constexpr int numDeals = 12;
+constexpr int maxPositions = 20000;
+}
+
+void TestSolverSpill::solverSpill_matchInMemory()
+{
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    std::unique_ptr<DealerScene> other( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    QVERIFY( dealer );
+    QVERIFY( other );
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+
+    // A budget this small has the seen positions spill to disk early on.
+    SolverInterface *spilling = other->solver();
+    spilling->setMemoryBudget( 1 << 20 );
+    spilling->setSpillDirectory( dir.path() );
+
+    unsigned long spilled = 0;
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        dealGame( other.get(), firstDeal + i );
+        const SearchResult expected = solve( dealer->solver(), maxPositions );
+        const unsigned long positions = dealer->solver()->stats().positions;
+
+        // Seen positions are the same whether they are on disk or not, so
+        // unless the live ones outgrow the budget, the search is too.
+        const SearchResult have = solve( spilling, maxPositions );
+        spilled += spilling->stats().spilled;
+        if ( have.status == SolverInterface::MemoryLimitReached && expected.status != have.status )
+            continue;
+        compareResults( have, expected );
+        QCOMPARE( spilling->stats().positions, positions );
+    }
+    QVERIFY( spilled > 0 );
+    QVERIFY( QDir( dir.path() ).isEmpty() );
+}
+
+QTEST_MAIN(TestSolverSpill)
+#include "solver_spill.moc"
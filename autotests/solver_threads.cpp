@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs the same deals through several solvers at once and checks that
+// every solver comes to the same conclusion as when running alone, and
+// that a single solver searching with several threads does too.
+#include <QTest>
+#include <QThread>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+#include <vector>
+
+class TestSolverThreads: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void solverThreads_matchSequential();
+    void solverThreads_parallelSearch();
+};
+
+namespace
+{
+// Klondike deals branch enough to keep several threads busy, and the cap
+// turns the ones that take long into quick MemoryLimitReached results.
+constexpr int firstDeal = 1;
+constexpr int numDeals = 12;
+constexpr int maxPositions = 20000;
+constexpr int rounds = 3;
+}
+
+void TestSolverThreads::solverThreads_matchSequential()
+{
+    std::vector<std::unique_ptr<DealerScene>> dealers;
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealers.emplace_back( getDealer( DealerInfo::KlondikeDrawOneId ) );
+        QVERIFY( dealers.back() );
+    }
+
+    // One solver at a time.
+    std::vector<SearchResult> expected( numDeals );
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealers[i].get(), firstDeal + i );
+        expected[i] = solve( dealers[i]->solver(), maxPositions );
+    }
+
+    // All solvers at once; the layouts are translated up front since
+    // the scenes belong to this thread.
+    for ( int round = 0; round < rounds; ++round )
+    {
+        std::vector<SearchResult> results( numDeals );
+        std::vector<QThread *> threads;
+        for ( int i = 0; i < numDeals; ++i )
+        {
+            SolverInterface *solver = dealers[i]->solver();
+            dealGame( dealers[i].get(), firstDeal + i );
+            SearchResult *result = &results[i];
+            threads.push_back( QThread::create( [solver, result] {
+                *result = solve( solver, maxPositions );
+            } ) );
+        }
+        for ( QThread *t : threads )
+            t->start();
+        for ( QThread *t : threads )
+        {
+            QVERIFY( t->wait() );
+            delete t;
+        }
+
+        for ( int i = 0; i < numDeals; ++i )
+            compareResults( results[i], expected[i] );
+    }
+}
+
+void TestSolverThreads::solverThreads_parallelSearch()
+{
+    std::unique_ptr<DealerScene> dealer( getDealer( DealerInfo::KlondikeDrawOneId ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+
+    for ( int i = 0; i < numDeals; ++i )
+    {
+        dealGame( dealer.get(), firstDeal + i );
+        solver->setThreads( 1 );
+        const int expected = solver->patsolve( maxPositions );
+
+        // The threads find their own solution, if any, and may need more
+        // positions for it; a deal without one is searched in full by
+        // either.
+        solver->translate_layout();
+        solver->setThreads( 4 );
+        const int status = solver->patsolve( maxPositions );
+        if ( expected == SolverInterface::NoSolutionExists )
+            QCOMPARE( status, expected );
+        else if ( expected == SolverInterface::SolutionExists && status != SolverInterface::MemoryLimitReached )
+            QCOMPARE( status, expected );
+        if ( status == SolverInterface::SolutionExists )
+            QVERIFY( !solver->winMoves().isEmpty() );
+    }
+}
+
+QTEST_MAIN(TestSolverThreads)
+#include "solver_threads.moc"
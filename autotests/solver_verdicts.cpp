@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Solves fixed deals of the games whose positions are clustered by what
+// went out, and checks that they still come out won or lost as they did
+// before the clusters changed.
+#include <QStandardPaths>
+#include <QTest>
+#include "dealer.h"
+#include "dealerinfo.h"
+#include "solver_helpers.h"
+
+#include <memory>
+
+class TestSolverVerdicts: public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void solverVerdicts_data();
+    void solverVerdicts();
+};
+
+namespace
+{
+// Enough for the Spider deals, which the other games stay far below.
+constexpr size_t memoryBudget = size_t( 128 ) << 20;
+
+void addDeal( const char *name, int game, int deal, int maxPositions, int expected )
+{
+    QTest::newRow( qPrintable( QStringLiteral( "%1 %2" ).arg( QLatin1String( name ) ).arg( deal ) ) )
+        << game << deal << maxPositions << expected;
+}
+}
+
+void TestSolverVerdicts::initTestCase()
+{
+    // Keep tuned solver parameters of the user out of it.
+    QStandardPaths::setTestModeEnabled( true );
+}
+
+void TestSolverVerdicts::solverVerdicts_data()
+{
+    QTest::addColumn<int>( "game" );
+    QTest::addColumn<int>( "deal" );
+    QTest::addColumn<int>( "maxPositions" );
+    QTest::addColumn<int>( "expected" );
+
+    const int won = SolverInterface::SolutionExists;
+    const int lost = SolverInterface::NoSolutionExists;
+
+    for ( int deal : { 4, 5, 7, 16, 17, 20 } )
+        addDeal( "gypsy", DealerInfo::GypsyId, deal, 100000, won );
+
+    for ( int deal : { 1, 3, 8, 10, 17, 20 } )
+        addDeal( "mod3", DealerInfo::Mod3Id, deal, 100000, won );
+    for ( int deal : { 4, 14 } )
+        addDeal( "mod3", DealerInfo::Mod3Id, deal, 100000, lost );
+
+    for ( int deal : { 2, 4, 13, 20 } )
+        addDeal( "acesup", DealerInfo::AcesUpId, deal, 100000, won );
+    for ( int deal : { 5, 8, 16 } )
+        addDeal( "acesup", DealerInfo::AcesUpId, deal, 100000, lost );
+
+    for ( int deal : { 1, 3, 4 } )
+        addDeal( "clock", DealerInfo::GrandfathersClockId, deal, 100000, won );
+    addDeal( "clock", DealerInfo::GrandfathersClockId, 2, 100000, lost );
+
+    // Legs of both suits go out on the way.
+    for ( int deal : { 4, 14 } )
+        addDeal( "spider2", DealerInfo::SpiderTwoSuitId, deal, 500000, won );
+}
+
+void TestSolverVerdicts::solverVerdicts()
+{
+    QFETCH( int, game );
+    QFETCH( int, deal );
+    QFETCH( int, maxPositions );
+    QFETCH( int, expected );
+
+    std::unique_ptr<DealerScene> dealer( getDealer( game ) );
+    QVERIFY( dealer );
+    SolverInterface *solver = dealer->solver();
+    solver->setMemoryBudget( memoryBudget );
+
+    dealGame( dealer.get(), deal );
+    const SearchResult result = solve( solver, maxPositions );
+    QCOMPARE( result.status, expected );
+    QCOMPARE( result.winMoves.isEmpty(), expected != SolverInterface::SolutionExists );
+}
+
+QTEST_MAIN(TestSolverVerdicts)
+#include "solver_verdicts.moc"
@@ -65,6 +65,9 @@ namespace
 {
     const qreal wonBoxToSceneSizeRatio = 0.7;
 
+    // How long the background solver may take before it gives up, in ms.
+    const qint64 solverTimeLimit = 60 * 1000;
+
     QString solverStatusMessage( int status, bool everWinnable )
     {
         switch ( status )
@@ -75,6 +78,7 @@ namespace
             return everWinnable ? i18n("Solver: This game is no longer winnable.")
                                 : i18n("Solver: This game cannot be won.");
         case SolverInterface::UnableToDetermineSolvability:
+        case SolverInterface::DeadlineReached:
             return i18n("Solver: Unable to determine if this game is winnable.");
         case SolverInterface::SearchAborted:
         case SolverInterface::MemoryLimitReached:
@@ -155,7 +159,13 @@ public:
 
     void run() override
     {
+        m_solver->setThreads( QThread::idealThreadCount() );
+        m_solver->setTimeLimit( solverTimeLimit );
         SolverInterface::ExitStatus result = m_solver->patsolve();
+        const SolverInterface::Stats stats = m_solver->stats();
+        qCDebug(KPAT_LOG) << "Solver finished with" << result << "after" << stats.usecs << "us,"
+                          << stats.positions << "positions," << stats.peakFrontier << "queued at most,"
+                          << stats.peakMemory << "of" << m_solver->memoryBudget() << "bytes";
         Q_EMIT finished( result );
     }
 
@@ -685,9 +695,8 @@ QList<MoveHint> DealerScene::getSolverHints()
         m_solverThread->abort();
 
     solver()->translate_layout();
-    solver()->patsolve( 1 );
 
-    const auto moves = solver()->firstMoves();
+    const auto moves = solver()->legalMoves();
     for (const MOVE & m : moves) {
         MoveHint mh = solver()->translateMove( m );
 	hintList << mh;
@@ -1687,6 +1696,30 @@ void DealerScene::setSolver( SolverInterface *s) {
     delete m_solverThread;
     m_solver = s;
     m_solverThread = nullptr;
+
+    if ( m_solver )
+    {
+        const KConfigGroup config( KSharedConfig::openConfig( QStringLiteral( solver_parameters_file ) ), solverParametersGroup() );
+        const QList<qreal> parameters = config.readEntry( "Parameters", QList<qreal>() );
+        if ( !parameters.isEmpty() )
+            m_solver->setParameters( parameters.toVector() );
+    }
+}
+
+// Store the solver tuning of this game where setSolver() picks it up,
+// for every scene created from now on.
+void DealerScene::saveSolverParameters( const QVector<qreal> & parameters ) const
+{
+    KConfigGroup config( KSharedConfig::openConfig( QStringLiteral( solver_parameters_file ) ), solverParametersGroup() );
+    config.writeEntry( "Parameters", parameters.toList() );
+    config.sync();
+}
+
+// Variants such as Klondike draw one and draw three search differently,
+// so each has a group of its own.
+QString DealerScene::solverParametersGroup() const
+{
+    return QStringLiteral( "%1-%2" ).arg( m_di->baseIdString() ).arg( oldId() );
 }
 
 bool DealerScene::isGameWon() const
@@ -1717,6 +1750,12 @@ bool DealerScene::isGameLost() const
         if ( m_solverThread && m_solverThread->isRunning() )
             m_solverThread->abort();
 
+        // The background search left its own settings behind; this quick
+        // check runs on the GUI thread, and is bounded by its positions.
+        // The search it stopped is kept, and the next background search
+        // goes on with it.
+        solver()->setThreads( 1 );
+        solver()->setTimeLimit( -1 );
         solver()->translate_layout();
         return solver()->patsolve( neededFutureMoves() ) == SolverInterface::NoSolutionExists;
     }
@@ -61,6 +61,7 @@ class SolverThread;
 class QAction;
 
 #define scores_group "Scores"
+#define solver_parameters_file "kpatsolverrc"
 
 class DealerScene : public KCardScene
 {
@@ -108,6 +109,7 @@ public:
     void setSolverEnabled( bool enabled );
     SolverInterface * solver() const;
     void startSolver();
+    void saveSolverParameters( const QVector<qreal> & parameters ) const;
 
     virtual bool isGameLost() const;
     virtual bool isGameWon() const;
@@ -225,6 +227,8 @@ private:
 
     int speedUpTime( int delay ) const;
 
+    QString solverParametersGroup() const;
+
     void multiStepSubMove( QList<KCard*> cards,
                            KCardPile * pile,
                            QList<KCardPile*> freePiles,
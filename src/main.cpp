@@ -52,6 +52,7 @@
 #include <Kdelibs4ConfigMigrator>
 // Qt
 #include <QRandomGenerator>
+#include <QDir>
 #include <QFile>
 #include <QTime>
 #include <QElapsedTimer>
@@ -60,8 +61,20 @@
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThread>
+#include <QWaitCondition>
 // Std
+#include <algorithm>
 #include <climits>
+#include <functional>
+#include <memory>
+#include <vector>
 
 static DealerScene *getDealer( int wanted_game , const QString & name )
 {
@@ -73,6 +86,8 @@ static DealerScene *getDealer( int wanted_game , const QString & name )
             Q_ASSERT( d );
             d->setDeck( new KCardDeck( KCardTheme(), d ) );
             d->initialize();
+            if ( wanted_game >= 0 )
+                d->mapOldId( wanted_game );
 
             if ( !d->solver() )
             {
@@ -86,6 +101,426 @@ static DealerScene *getDealer( int wanted_game , const QString & name )
     return nullptr;
 }
 
+namespace
+{
+// One worker of the --solve batch mode.  The scene lives in the main
+// thread, which deals every game and translates it for the solver; only
+// patsolve() runs on the worker's thread.
+struct SolveWorker
+{
+    DealerScene *dealer = nullptr;
+    QThread *thread = nullptr;
+    QSemaphore go;
+    int deal = -1;              // -1 tells the worker to quit
+    int result = SolverInterface::UnableToDetermineSolvability;
+    qint64 elapsed = 0;
+    SolverInterface::Stats stats;
+    QString checkpointDir;      // where searches that ran out of time go
+    QString checkpoint;         // the checkpoint of the deal, if any
+};
+
+struct SolveOptions
+{
+    int jobs = 1;
+    size_t budget = 0;          // bytes per deal, 0 keeps the solver's default
+    qint64 timeLimit = -1;      // ms per deal, -1 for none
+    bool compact = false;
+    bool symmetry = false;
+    bool dedicated = false;
+    int portfolio = 1;
+    bool json = false;
+    QString checkpointDir;      // empty for no checkpoints
+    QString spillDir;           // empty to keep the seen positions in memory
+};
+
+struct SolveResult
+{
+    int result;
+    qint64 elapsed;
+    SolverInterface::Stats stats;
+};
+
+QString statusName( int status )
+{
+    switch ( status )
+    {
+    case SolverInterface::SolutionExists:
+        return QStringLiteral("won");
+    case SolverInterface::NoSolutionExists:
+        return QStringLiteral("lost");
+    case SolverInterface::SearchAborted:
+        return QStringLiteral("aborted");
+    case SolverInterface::MemoryLimitReached:
+        return QStringLiteral("position limit");
+    case SolverInterface::DeadlineReached:
+        return QStringLiteral("deadline");
+    default:
+        return QStringLiteral("unknown");
+    }
+}
+
+QJsonObject statsToJson( qint64 deal, const SolveResult & r )
+{
+    QJsonObject o;
+    o[QStringLiteral("deal")] = deal;
+    o[QStringLiteral("status")] = statusName( r.stats.status );
+    o[QStringLiteral("ms")] = r.elapsed;
+    o[QStringLiteral("solve_us")] = r.stats.usecs;
+    o[QStringLiteral("moves")] = double( r.stats.moves );
+    o[QStringLiteral("generated")] = double( r.stats.generated );
+    o[QStringLiteral("positions")] = double( r.stats.positions );
+    o[QStringLiteral("compared")] = double( r.stats.compared );
+    o[QStringLiteral("mismatched")] = double( r.stats.mismatched );
+    o[QStringLiteral("spilled")] = double( r.stats.spilled );
+    o[QStringLiteral("peak_frontier")] = double( r.stats.peakFrontier );
+    o[QStringLiteral("peak_memory")] = double( r.stats.peakMemory );
+    o[QStringLiteral("piles")] = r.stats.piles;
+    o[QStringLiteral("pile_table_size")] = double( r.stats.pileTableSize );
+    o[QStringLiteral("config")] = r.stats.config;
+    o[QStringLiteral("refuted")] = r.stats.refuted;
+    return o;
+}
+}
+
+// Set up one worker for each of the jobs the options ask for, each with a
+// scene of the game and its solver set up as the options say.
+static bool makeWorkers( int wanted_game, const QString & wanted_name, const SolveOptions & options,
+                         std::vector<std::unique_ptr<SolveWorker>> & workers )
+{
+    for ( int j = 0; j < options.jobs; ++j )
+    {
+        DealerScene *f = getDealer( wanted_game, wanted_name );
+        if ( !f )
+            return false;
+        if ( options.budget > 0 )
+            f->solver()->setMemoryBudget( options.budget );
+        f->solver()->setLargePages( true );
+        f->solver()->setCompactPositions( options.compact );
+        f->solver()->setSymmetryReduction( options.symmetry );
+        f->solver()->setDedicatedSearch( options.dedicated );
+        f->solver()->setPortfolio( options.portfolio );
+        f->solver()->setTimeLimit( options.timeLimit );
+        f->solver()->setSpillDirectory( options.spillDir );
+        workers.emplace_back( new SolveWorker );
+        workers.back()->dealer = f;
+        workers.back()->checkpointDir = options.checkpointDir;
+    }
+    return true;
+}
+
+// Solve the deals start_index..end_index on the workers.  Deals are handed
+// out one at a time as workers become idle, and report() gets the results
+// in deal order.  With a checkpoint directory, a search that runs out of
+// time is saved there, and goes on from there the next time the deal is
+// solved.
+static void solveDeals( std::vector<std::unique_ptr<SolveWorker>> & workers,
+                        int start_index, int end_index,
+                        const std::function<void( qint64, const SolveResult & )> & report )
+{
+    QMutex mutex;
+    QWaitCondition doneCondition;
+    QList<SolveWorker *> done;
+
+    for ( auto &w : workers )
+    {
+        SolveWorker *worker = w.get();
+        worker->thread = QThread::create( [worker, &mutex, &doneCondition, &done] {
+            QElapsedTimer mytime;
+            for ( ;; )
+            {
+                worker->go.acquire();
+                if ( worker->deal < 0 )
+                    return;
+                mytime.start();
+                SolverInterface *solver = worker->dealer->solver();
+                if ( !worker->checkpoint.isEmpty() )
+                    solver->loadCheckpoint( worker->checkpoint );
+                worker->result = solver->patsolve();
+                if ( !worker->checkpoint.isEmpty() && !solver->saveCheckpoint( worker->checkpoint ) )
+                    QFile::remove( worker->checkpoint );
+                worker->elapsed += mytime.elapsed();
+                worker->stats = solver->stats();
+
+                QMutexLocker lock( &mutex );
+                done.append( worker );
+                doneCondition.wakeOne();
+            }
+        } );
+        worker->thread->start();
+    }
+
+    qint64 next = start_index;
+    auto dispatch = [&next, end_index]( SolveWorker *worker ) {
+        if ( next > end_index )
+        {
+            worker->deal = -1;
+            worker->go.release();
+            return false;
+        }
+        QElapsedTimer mytime;
+        mytime.start();
+        worker->deal = next++;
+        worker->dealer->deck()->stopAnimations();
+        worker->dealer->startNew( worker->deal );
+        worker->dealer->solver()->translate_layout();
+        if ( !worker->checkpointDir.isEmpty() )
+            worker->checkpoint = QStringLiteral("%1/%2-%3.kpatsearch").arg( worker->checkpointDir ).arg( worker->dealer->gameId() ).arg( worker->deal );
+        worker->elapsed = mytime.elapsed();
+        worker->go.release();
+        return true;
+    };
+
+    int running = 0;
+    for ( auto &w : workers )
+        if ( dispatch( w.get() ) )
+            ++running;
+
+    QMap<qint64, SolveResult> pending;
+    qint64 nextToPrint = start_index;
+    while ( running > 0 )
+    {
+        SolveWorker *worker;
+        {
+            QMutexLocker lock( &mutex );
+            while ( done.isEmpty() )
+                doneCondition.wait( &mutex );
+            worker = done.takeFirst();
+        }
+        pending.insert( worker->deal, { worker->result, worker->elapsed, worker->stats } );
+        if ( !dispatch( worker ) )
+            --running;
+
+        for ( auto it = pending.begin(); it != pending.end() && it.key() == nextToPrint; it = pending.erase( it ) )
+        {
+            report( it.key(), *it );
+            ++nextToPrint;
+        }
+    }
+
+    for ( auto &w : workers )
+    {
+        w->thread->wait();
+        delete w->thread;
+        w->thread = nullptr;
+    }
+}
+
+// Solve the deals start_index..end_index with the given number of workers,
+// each set up as the options say.  The results are printed in deal order,
+// either as text or, with json, as a single JSON document with the solver
+// statistics of every deal.
+static int solveRange( int wanted_game, const QString & wanted_name,
+                       int start_index, int end_index, const SolveOptions & options )
+{
+    const int jobs = options.jobs;
+    const bool json = options.json;
+    std::vector<std::unique_ptr<SolveWorker>> workers;
+    if ( !makeWorkers( wanted_game, wanted_name, options, workers ) )
+        return 1;
+
+    QElapsedTimer total;
+    total.start();
+
+    qint64 count = 0;
+    size_t maxPeak = 0;
+    qint64 refuted = 0;
+    QMap<int, int> configWins;
+    QJsonArray dealStats;
+    solveDeals( workers, start_index, end_index, [&]( qint64 deal, const SolveResult & r ) {
+        if ( json )
+        {
+            dealStats.append( statsToJson( deal, r ) );
+        }
+        else
+        {
+            const char *verdict = "unknown";
+            if ( r.result == SolverInterface::SolutionExists )
+                verdict = "won";
+            else if ( r.result == SolverInterface::NoSolutionExists )
+                verdict = "lost";
+            else if ( r.result == SolverInterface::DeadlineReached )
+                verdict = "deadline";
+            fprintf( stdout, "%lld %s (%lld ms, %zu KB peak)\n", deal, verdict, r.elapsed, r.stats.peakMemory / 1024 );
+        }
+        maxPeak = qMax( maxPeak, r.stats.peakMemory );
+        if ( r.stats.config >= 0 )
+            ++configWins[r.stats.config];
+        if ( r.stats.refuted )
+            ++refuted;
+        ++count;
+    } );
+
+    const qint64 ms = total.elapsed();
+    if ( json )
+    {
+        QJsonObject run;
+        run[QStringLiteral("game")] = workers.front()->dealer->gameId();
+        run[QStringLiteral("jobs")] = jobs;
+        if ( options.portfolio > 1 )
+        {
+            QJsonObject wins;
+            for ( auto it = configWins.cbegin(); it != configWins.cend(); ++it )
+                wins[QString::number( it.key() )] = it.value();
+            run[QStringLiteral("portfolio")] = options.portfolio;
+            run[QStringLiteral("portfolio_wins")] = wins;
+        }
+        run[QStringLiteral("ms")] = ms;
+        run[QStringLiteral("all_moves")] = double( all_moves.load() );
+        run[QStringLiteral("peak_memory")] = double( maxPeak );
+        run[QStringLiteral("refuted")] = refuted;
+        run[QStringLiteral("deals")] = dealStats;
+        fputs( QJsonDocument( run ).toJson().constData(), stdout );
+        return 0;
+    }
+    fprintf( stdout, "all_moves %ld\n", all_moves.load() );
+    fprintf( stdout, "peak memory %zu KB\n", maxPeak / 1024 );
+    if ( refuted > 0 )
+        fprintf( stdout, "%lld deals lost before searching\n", refuted );
+    if ( options.portfolio > 1 )
+    {
+        fprintf( stdout, "portfolio wins:" );
+        for ( auto it = configWins.cbegin(); it != configWins.cend(); ++it )
+            fprintf( stdout, " %d:%d", it.key(), it.value() );
+        fprintf( stdout, "\n" );
+    }
+    fprintf( stdout, "%lld deals in %lld ms with %d jobs (%.1f deals/s)\n",
+             count, ms, jobs, ms > 0 ? count * 1000.0 / ms : 0.0 );
+    return 0;
+}
+
+namespace
+{
+// How a set of solver parameters did on the tuning deals.  Times are the
+// solver's own (Stats::usecs), so dealing the cards does not count.
+struct TuneScore
+{
+    int conclusive = 0;         // deals found won or lost
+    qint64 median = 0;          // usecs
+    qint64 p95 = 0;
+};
+
+// More conclusive deals is better; then the sum of the median and 95th
+// percentile times, which has to drop by 2% to count, so that timing noise
+// does not wander off with the parameters.
+bool betterScore( const TuneScore & a, const TuneScore & b )
+{
+    if ( a.conclusive != b.conclusive )
+        return a.conclusive > b.conclusive;
+    return ( a.median + a.p95 ) * 50 < ( b.median + b.p95 ) * 49;
+}
+
+QString parametersString( const QVector<qreal> & p )
+{
+    QStringList l;
+    for ( qreal x : p )
+        l << QString::number( x );
+    return l.join( QLatin1Char( ',' ) );
+}
+}
+
+// Tune the solver of a game on the deals start_index..end_index: starting
+// from its current parameters, try each one a step up and down, keep any
+// change that scores better, and halve the steps after a round without
+// one, down to a sixteenth of where they started, or whole steps for the
+// move priorities; it ends there or after the given number of rounds.
+// The best parameters found are saved to the solver parameter file,
+// which the game loads from then on.  The first three parameters are the
+// queue curve (see SolverInterface::parameters()); the others are move
+// priorities and only take whole steps.
+static int tuneRange( int wanted_game, const QString & wanted_name,
+                      int start_index, int end_index, SolveOptions options, int rounds )
+{
+    if ( end_index < start_index )
+    {
+        fprintf( stderr, "No deals to tune on: the range %d..%d is empty\n", start_index, end_index );
+        return 1;
+    }
+    options.portfolio = 1;
+    options.checkpointDir.clear();
+    std::vector<std::unique_ptr<SolveWorker>> workers;
+    if ( !makeWorkers( wanted_game, wanted_name, options, workers ) )
+        return 1;
+
+    QVector<qreal> best = workers.front()->dealer->solver()->parameters();
+    if ( best.isEmpty() )
+    {
+        fprintf( stderr, "The solver of this game has nothing to tune\n" );
+        return 1;
+    }
+
+    auto evaluate = [&]( const QVector<qreal> & p ) {
+        std::vector<qint64> times;
+        TuneScore score;
+        for ( auto &w : workers )
+            w->dealer->solver()->setParameters( p );
+        solveDeals( workers, start_index, end_index, [&]( qint64, const SolveResult & r ) {
+            if ( r.result == SolverInterface::SolutionExists || r.result == SolverInterface::NoSolutionExists )
+                ++score.conclusive;
+            times.push_back( r.stats.usecs );
+        } );
+        std::sort( times.begin(), times.end() );
+        score.median = times[times.size() / 2];
+        score.p95 = times[( times.size() * 95 + 99 ) / 100 - 1];
+        fprintf( stdout, "%s: %d/%zu conclusive, median %.1f ms, p95 %.1f ms\n",
+                 qPrintable( parametersString( p ) ), score.conclusive, times.size(),
+                 score.median / 1000.0, score.p95 / 1000.0 );
+        fflush( stdout );
+        return score;
+    };
+
+    QVector<qreal> step( best.size() );
+    QVector<qreal> minStep( best.size() );
+    for ( int i = 0; i < best.size(); ++i )
+    {
+        step[i] = qAbs( best[i] ) / 4;
+        if ( i >= 3 )
+            step[i] = qMax( 1, qRound( step[i] ) );
+        else if ( step[i] == 0 )
+            step[i] = 0.01;
+        minStep[i] = i >= 3 ? 1 : step[i] / 16;
+    }
+
+    TuneScore bestScore = evaluate( best );
+    for ( int round = 0; round < rounds; ++round )
+    {
+        bool improved = false;
+        for ( int i = 0; i < best.size(); ++i )
+        {
+            for ( int sign : { 1, -1 } )
+            {
+                QVector<qreal> p = best;
+                p[i] += sign * step[i];
+                const TuneScore score = evaluate( p );
+                if ( betterScore( score, bestScore ) )
+                {
+                    best = p;
+                    bestScore = score;
+                    improved = true;
+                    break;
+                }
+            }
+        }
+        if ( improved )
+            continue;
+
+        bool moved = false;
+        for ( int i = 0; i < best.size(); ++i )
+        {
+            const qreal half = i >= 3 ? qMax( 1, qRound( step[i] / 2 ) ) : qMax( minStep[i], step[i] / 2 );
+            moved = moved || half != step[i];
+            step[i] = half;
+        }
+        if ( !moved )
+            break;
+    }
+
+    workers.front()->dealer->saveSolverParameters( best );
+    fprintf( stdout, "best %s: %d conclusive, median %.1f ms, p95 %.1f ms, saved to %s\n",
+             qPrintable( parametersString( best ) ), bestScore.conclusive,
+             bestScore.median / 1000.0, bestScore.p95 / 1000.0, solver_parameters_file );
+    return 0;
+}
+
 // A function to remove all nonalphanumeric characters from a string
 // and convert all letters to lowercase.
 QString lowerAlphaNum( const QString & string )
@@ -195,6 +630,17 @@ int main( int argc, char **argv )
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("solve"), i18n("Dealer to solve (debug)" ), QStringLiteral("num")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("start"), i18n("Game range start (default 0:INT_MAX)" ), QStringLiteral("num")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("end"), i18n("Game range end (default start:start if start given)" ), QStringLiteral("num")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("jobs"), i18n("Number of deals to solve in parallel (default 1, 0 for one per CPU)" ), QStringLiteral("num")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("stats"), i18n("Print the solver statistics of every deal as JSON (debug)" )));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("memory"), i18n("Memory budget of each solver in megabytes (debug)" ), QStringLiteral("num")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("deadline"), i18n("Give up on a deal after this many milliseconds (debug)" ), QStringLiteral("ms")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("checkpoint"), i18n("Save the searches that reach the deadline to this directory, and go on with them from there (debug)" ), QStringLiteral("directory")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("spill"), i18n("Let the positions a search has seen spill to files in this directory when memory runs short (debug)" ), QStringLiteral("directory")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("compact"), i18n("Store solver positions compactly, fitting more in the memory budget (debug)" )));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("symmetry"), i18n("Take solver positions that only differ in the order of interchangeable piles for one (debug)" )));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("dedicated"), i18n("Solve games that have a search of their own with it, one thread per deal (debug)" )));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("tune"), i18n("Tune the solver on the game range for this many rounds and save the result (debug)" ), QStringLiteral("num")));
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("portfolio"), i18n("Race this many differently tuned searches on every deal (debug)" ), QStringLiteral("num")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("gametype"), i18n("Skip the selection screen and load a particular game type. Valid values are: %1",gameList.join(listSeparator)), QStringLiteral("game")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("testdir"), i18n( "Directory with test cases" ), QStringLiteral("directory")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("generate"), i18n( "Generate random test cases" )));
@@ -297,27 +743,46 @@ int main( int argc, char **argv )
             if ( end_index == -1 )
                 end_index = start_index;
         }
-        DealerScene *f = getDealer( wanted_game , wanted_name );
-        if ( !f )
-            return 1;
+        SolveOptions options;
+        ok = false;
+        if ( parser.isSet( QStringLiteral("jobs") ) )
+            options.jobs = parser.value(QStringLiteral("jobs")).toInt( &ok );
+        if ( !ok || options.jobs < 0 )
+            options.jobs = 1;
+        else if ( options.jobs == 0 )
+            options.jobs = qMax( 1, QThread::idealThreadCount() );
+        ok = false;
+        if ( parser.isSet( QStringLiteral("memory") ) )
+            options.budget = size_t( parser.value(QStringLiteral("memory")).toUInt( &ok ) ) * 1000 * 1000;
+        if ( !ok )
+            options.budget = 0;
+        ok = false;
+        if ( parser.isSet( QStringLiteral("deadline") ) )
+            options.timeLimit = parser.value(QStringLiteral("deadline")).toLongLong( &ok );
+        if ( !ok || options.timeLimit < 0 )
+            options.timeLimit = -1;
+        ok = false;
+        if ( parser.isSet( QStringLiteral("portfolio") ) )
+            options.portfolio = parser.value(QStringLiteral("portfolio")).toInt( &ok );
+        if ( !ok || options.portfolio < 1 )
+            options.portfolio = 1;
+        options.compact = parser.isSet( QStringLiteral("compact") );
+        options.symmetry = parser.isSet( QStringLiteral("symmetry") );
+        options.dedicated = parser.isSet( QStringLiteral("dedicated") );
+        options.checkpointDir = parser.value(QStringLiteral("checkpoint"));
+        if ( !options.checkpointDir.isEmpty() )
+            QDir().mkpath( options.checkpointDir );
+        options.spillDir = parser.value(QStringLiteral("spill"));
+        if ( !options.spillDir.isEmpty() )
+            QDir().mkpath( options.spillDir );
+        options.json = parser.isSet( QStringLiteral("stats") );
 
-        QElapsedTimer mytime;
-        for ( int i = start_index; i <= end_index; i++ )
+        if ( parser.isSet( QStringLiteral("tune") ) )
         {
-            mytime.start();
-            f->deck()->stopAnimations();
-            f->startNew( i );
-            f->solver()->translate_layout();
-            int ret = f->solver()->patsolve();
-            if ( ret == SolverInterface::SolutionExists )
-                fprintf( stdout, "%d won (%lld ms)\n", i, mytime.elapsed() );
-            else if ( ret == SolverInterface::NoSolutionExists )
-                fprintf( stdout, "%d lost (%lld ms)\n", i, mytime.elapsed()  );
-            else
-                fprintf( stdout, "%d unknown (%lld ms)\n", i, mytime.elapsed() );
+            const int rounds = parser.value(QStringLiteral("tune")).toInt( &ok );
+            return tuneRange( wanted_game, wanted_name, start_index, end_index, options, ok ? qMax( 1, rounds ) : 4 );
         }
-        fprintf( stdout, "all_moves %ld\n", all_moves );
-        return 0;
+        return solveRange( wanted_game, wanted_name, start_index, end_index, options );
     }
 
     QString gametype = parser.value(QStringLiteral("gametype")).toLower();
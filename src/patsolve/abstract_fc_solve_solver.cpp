@@ -52,9 +52,9 @@ const auto SOFT_SUSPEND = FCS_STATE_SUSPEND_PROCESS;
 #endif
 
 /* Get the possible moves from a position, and store them in Possible[]. */
-SolverInterface::ExitStatus FcSolveSolver::patsolve( int _max_positions )
+SolverInterface::ExitStatus FcSolveSolver::search( int _max_positions )
 {
-    int current_iters_count;
+    int current_iters_count = 0;
     max_positions = (_max_positions < 0) ? default_max_positions : _max_positions;
 
     init();
@@ -155,13 +155,18 @@ SolverInterface::ExitStatus FcSolveSolver::patsolve( int _max_positions )
             }
             {
                 // QMutexLocker lock( &endMutex );
-                if ( m_shouldEnd )
+                if ( m_shouldEnd || End.hasExpired() )
                 {
                     continue_loop = false;
                 }
             }
         }
     }
+    if ( solver_ret == SOFT_SUSPEND && !m_shouldEnd && End.hasExpired() )
+    {
+        make_solver_instance_ready();
+        return Solver::DeadlineReached;
+    }
     const long reached_iters = freecell_solver_user_get_num_times_long(solver_instance);
     Q_ASSERT(reached_iters <= default_max_positions);
 #if 0
@@ -35,7 +35,9 @@ public:
     void translate_layout() override = 0;
     void unpack_cluster( unsigned int k ) override;
     MoveHint translateMove(const MOVE &m) override = 0;
-    SolverInterface::ExitStatus patsolve( int _max_positions = -1) override;
+    SolverInterface::ExitStatus search( int _max_positions ) override;
+    QVector<qreal> parameters() const override { return {}; }
+    void setParameters(const QVector<qreal> &) override {}
     virtual void setFcSolverGameParams() = 0;
 
     void print_layout() override;
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "checkpoint.h"
+
+// Std
+#include <algorithm>
+
+namespace {
+constexpr quint32 MAGIC = 0x4b505343;       /* "KPSC" */
+constexpr quint32 VERSION = 3;
+constexpr qint64 CHUNK = 1 << 20;           /* bytes read at once by raw() */
+}
+
+CheckpointWriter::CheckpointWriter(const QString &fileName)
+    : File(fileName)
+{
+	Out.setVersion(QDataStream::Qt_5_12);
+	if (!File.open(QIODevice::WriteOnly)) {
+		Out.setStatus(QDataStream::WriteFailed);
+		return;
+	}
+	Out.setDevice(&File);
+	Out << MAGIC << VERSION;
+}
+
+void CheckpointWriter::raw(const void *p, size_t size)
+{
+	if (Out.status() == QDataStream::Ok &&
+	    File.write(static_cast<const char *>(p), size) != qint64(size)) {
+		Out.setStatus(QDataStream::WriteFailed);
+	}
+}
+
+/* Replace the file with what was written, if all of it was. */
+
+bool CheckpointWriter::commit()
+{
+	return Out.status() == QDataStream::Ok && File.commit();
+}
+
+CheckpointReader::CheckpointReader(const QString &fileName)
+    : File(fileName)
+{
+	quint32 magic = 0, version = 0;
+
+	In.setVersion(QDataStream::Qt_5_12);
+	if (!File.open(QIODevice::ReadOnly)) {
+		In.setStatus(QDataStream::ReadPastEnd);
+		return;
+	}
+	In.setDevice(&File);
+	In >> magic >> version;
+	if (magic != MAGIC || version != VERSION) {
+		fail();
+	}
+}
+
+/* Read size bytes into p.  Large blocks go a chunk at a time, so that
+the file is never held in memory besides where its contents belong. */
+
+bool CheckpointReader::raw(void *p, size_t size)
+{
+	char *to = static_cast<char *>(p);
+	qint64 left = qint64(size);
+
+	if (!ok()) {
+		return false;
+	}
+	if (left > File.size() - File.pos()) {
+		In.setStatus(QDataStream::ReadPastEnd);
+		return false;
+	}
+	while (left > 0) {
+		const qint64 chunk = qMin(left, CHUNK);
+		if (File.read(to, chunk) != chunk) {
+			fail();
+			break;
+		}
+		to += chunk;
+		left -= chunk;
+	}
+	return ok();
+}
+
+/* The saved block at from, size bytes of it, is now at to. */
+
+void Relocation::add(quint64 from, size_t size, void *to)
+{
+	Blocks.push_back({from, size, static_cast<quint8 *>(to), Bits});
+	Bits += (size + 7) / 8;
+}
+
+void Relocation::finish()
+{
+	std::sort(Blocks.begin(), Blocks.end(), [](const Moved &a, const Moved &b) {
+		return a.from < b.from;
+	});
+	Marks.assign((Bits + 63) / 64, 0);
+}
+
+/* Where from went, or null if it is null.  A pointer to anywhere else
+means the file is broken; then ok() turns false. */
+
+void *Relocation::translate(quint64 from, size_t *mark)
+{
+	if (from == 0) {
+		return nullptr;
+	}
+	auto it = std::upper_bound(Blocks.begin(), Blocks.end(), from, [](quint64 p, const Moved &b) {
+		return p < b.from;
+	});
+	if (it == Blocks.begin() || from - (it - 1)->from >= (it - 1)->size) {
+		Failed = true;
+		return nullptr;
+	}
+	--it;
+	if (mark) {
+		*mark = it->mark + (from - it->from) / 8;
+	}
+	return it->to + (from - it->from);
+}
+
+bool Relocation::visit(const void *from)
+{
+	size_t mark;
+	quint64 bit;
+
+	if (translate(quint64(quintptr(from)), &mark) == nullptr) {
+		return false;
+	}
+	bit = Q_UINT64_C(1) << (mark & 63);
+	if (Marks[mark / 64] & bit) {
+		return false;
+	}
+	Marks[mark / 64] |= bit;
+	return true;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+// Qt
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+// Std
+#include <vector>
+
+/* A saved search, see Solver::saveCheckpoint().  The file starts with a
+magic number and the format version; what follows is up to the solver.
+Numbers go through a QDataStream.  The position store and the tables go
+as they are in memory: they are written straight from there, and read
+straight back into place, so that neither needs a second copy of them.
+A checkpoint is only good for the build that wrote it. */
+
+class CheckpointWriter
+{
+public:
+    explicit CheckpointWriter(const QString &fileName);
+
+    template<class T>
+    CheckpointWriter &operator<<(const T &v) { Out << v; return *this; }
+    void raw(const void *p, size_t size);
+    bool commit();
+
+private:
+    QSaveFile File;
+    QDataStream Out;
+};
+
+class CheckpointReader
+{
+public:
+    explicit CheckpointReader(const QString &fileName);
+
+    template<class T>
+    CheckpointReader &operator>>(T &v) { In >> v; return *this; }
+    bool raw(void *p, size_t size);
+    void fail() { In.setStatus(QDataStream::ReadCorruptData); }
+    bool ok() const { return In.status() == QDataStream::Ok; }
+
+private:
+    QFile File;
+    QDataStream In;
+};
+
+/* Where the blocks of a restored position store went.  Pointers into the
+blocks are saved as they were; at() translates them.  visit() tells
+whether a location is met for the first time, for what can be reached
+along several paths. */
+
+class Relocation
+{
+public:
+    void add(quint64 from, size_t size, void *to);
+    void finish();
+
+    template<class T>
+    T *at(quint64 from) { return static_cast<T *>(translate(from, nullptr)); }
+    template<class T>
+    T *at(T *from) { return at<T>(quint64(quintptr(from))); }
+    bool visit(const void *from);
+    bool ok() const { return !Failed; }
+
+private:
+    struct Moved {
+        quint64 from;
+        size_t size;
+        quint8 *to;
+        size_t mark;                /* the first bit of it in Marks */
+    };
+
+    void *translate(quint64 from, size_t *mark);
+
+    std::vector<Moved> Blocks;      /* by from, once finish()ed */
+    std::vector<quint64> Marks;     /* a bit for every 8 bytes */
+    size_t Bits = 0;
+    bool Failed = false;
+};
+
+#endif // CHECKPOINT_H
@@ -55,7 +55,7 @@ void ClockSolver::make_move(MOVE *m)
         else
             W[8][to]++;
         Q_ASSERT( m->card_index == 0 );
-        hashpile( 8 );
+        rehashpile( 8, to );
     } else {
         Wp[to]++;
         *Wp[to] = card;
@@ -93,7 +93,7 @@ void ClockSolver::undo_move(MOVE *m)
         Wp[from]++;
         *Wp[from] = card;
         Wlen[from]++;
-        hashpile( 8 );
+        rehashpile( 8, to );
         hashpile( from );
     } else {
         card = *Wp[to];
@@ -225,12 +225,22 @@ int ClockSolver::getOuts()
     return ret;
 }
 
+unsigned int ClockSolver::getClusterNumber()
+{
+    return getOuts();
+}
+
 ClockSolver::ClockSolver(const Clock *dealer)
     : Solver()
 {
     deal = dealer;
 }
 
+ClockSolver *ClockSolver::clone() const
+{
+    return new ClockSolver( *this );
+}
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
 card).  Temp cells and Out on the last two lines, if any. */
 
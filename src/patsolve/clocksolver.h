@@ -27,11 +27,13 @@ class ClockSolver : public Solver<9>
 {
 public:
     explicit ClockSolver(const Clock *dealer);
+    ClockSolver *clone() const override;
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
     void make_move(MOVE *m) override;
     void undo_move(MOVE *m) override;
     int getOuts() override;
+    unsigned int getClusterNumber() override;
     void translate_layout() override;
     MoveHint translateMove(const MOVE &m) override;
 
@@ -24,6 +24,30 @@
 namespace {
 constexpr auto NUM_PILE = 8;
 constexpr auto NUM_DECK = 9;
+
+/* What a card not in sequence on top of its pile holds back. */
+int score(card_t card)
+{
+    return RANK(card) < 5 ? (13 - RANK(card)) * 20 : 0;
+}
+
+/* The number of cards in suit sequence on top of the len cards, and the
+sum of their scores. */
+int toprun(const card_t *cards, int len, int *sum)
+{
+    int i = len - 1;
+
+    *sum = 0;
+    if (len == 0)
+        return 0;
+    *sum = score(cards[i]);
+    while (i > 0 && SUIT(cards[i-1]) == SUIT(cards[i]) &&
+           RANK(cards[i-1]) == RANK(cards[i]) + 1) {
+        --i;
+        *sum += score(cards[i]);
+    }
+    return len - i;
+}
 }
 
 #define PRINT 0
@@ -45,39 +69,101 @@ void FortyeightSolver::checkState(FortyeightSolverState &d)
 
     for ( int w = 0; w < 8; w++ )
       {
-	d.empty[w] = (Wlen[w] == 0);
-	d.linedup[w] = true;
-	if ( !Wlen[w] ) 
+	const int len = Wlen[w];
+
+	d.empty[w] = (len == 0);
+	if ( !len )
 	  {
 	    d.freestores++;
 	    if (d.firstempty < 0) d.firstempty = w;
 	  }
-	d.highestbreak[w] = 0;
-	for (int i = 1; i < Wlen[w]; i++) 
-	  {
-	    card_t card1 = W[w][Wlen[w]-i-1];
-	    card_t card2 = W[w][Wlen[w]-i];
-	    if ( SUIT( card1 ) != SUIT( card2 ) ||
-		 RANK( card1 ) != RANK( card2 ) + 1 ) 
-	      {
-		d.highestbreak[w] = i - 1;
-		d.linedup[w] = false;
-		break;
-	      }
-	  }
+	d.linedup[w] = (Srun[w] == len);
+	d.highestbreak[w] = d.linedup[w] ? 0 : Srun[w] - 1;
 	d.fromscore[w] = 0;
-	for (int i = d.highestbreak[w] + 1; i < Wlen[w]; i++) 
+	if (len)
 	  {
-	    card_t card = W[w][Wlen[w]-i-1];
-	    if ( RANK(card) < 5 || RANK(card) == PS_ACE) {
-	      d.fromscore[w] += (13 - RANK(card)) * 20;
-	    }
+	    // a lined up pile counts all but its top card
+	    if (d.linedup[w])
+	      d.fromscore[w] = Srunscore[w] - score(*Wp[w]);
+	    else
+	      d.fromscore[w] = Sbelow[w];
+	    d.fromscore[w] /= len;
 	  }
-	if (Wlen[w])
-	  d.fromscore[w] /= Wlen[w];
       }
 }
 
+/* Sum up tableau pile w from scratch. */
+void FortyeightSolver::sumpile(int w)
+{
+    int below = 0;
+
+    Srun[w] = toprun(W[w], Wlen[w], &Srunscore[w]);
+    for (int i = 0; i < Wlen[w] - Srun[w]; i++)
+	below += score(W[w][i]);
+    Sbelow[w] = below;
+}
+
+/* Builds with HASHPILE_DEBUG, such as the solver tests, check what is
+kept of every tableau pile against its cards. */
+void FortyeightSolver::checkpiles()
+{
+#ifdef HASHPILE_DEBUG
+    for (int w = 0; w < 8; w++) {
+	int run, runscore, below = 0;
+
+	run = toprun(W[w], Wlen[w], &runscore);
+	for (int i = 0; i < Wlen[w] - run; i++)
+	    below += score(W[w][i]);
+	if (run != Srun[w] || runscore != Srunscore[w] || below != Sbelow[w])
+	    qFatal("sums of pile %d out of step with its cards", w);
+    }
+#endif
+}
+
+/* The n cards on top of pile w were just put there.  They are in suit
+sequence, and may go on with the one the pile had on top. */
+void FortyeightSolver::growpile(int w, int n)
+{
+    const card_t *cards = &W[w][Wlen[w] - n];
+    int sum = 0;
+
+    for (int i = 0; i < n; i++)
+	sum += score(cards[i]);
+    if ( Wlen[w] > n && SUIT( cards[-1] ) == SUIT( cards[0] ) &&
+	 RANK( cards[-1] ) == RANK( cards[0] ) + 1 )
+      {
+	Srun[w] += n;
+	Srunscore[w] += sum;
+      }
+    else
+      {
+	Sbelow[w] += Srunscore[w];
+	Srun[w] = n;
+	Srunscore[w] = sum;
+      }
+    Spile[w] = -1;
+}
+
+/* The n cards on top of pile w are about to go. */
+void FortyeightSolver::shrinkpile(int w, int n)
+{
+    const int len = Wlen[w] - n;
+
+    Q_ASSERT( n <= Srun[w] );
+    if ( n < Srun[w] )
+      {
+	for (int i = len; i < Wlen[w]; i++)
+	  Srunscore[w] -= score(W[w][i]);
+	Srun[w] -= n;
+      }
+    else
+      {
+	Srun[w] = toprun(W[w], len, &Srunscore[w]);
+	Sbelow[w] -= Srunscore[w];
+      }
+    Spile[w] = -1;
+}
+
 void FortyeightSolver::make_move(MOVE *m)
 {
 #if PRINT
@@ -130,6 +216,8 @@ void FortyeightSolver::make_move(MOVE *m)
         return;
     }
 
+    if ( from < 8 )
+      shrinkpile(from, m->card_index+1);
     for ( int i = m->card_index + 1; i > 0; --i )
     {
         card_t card = W[from][Wlen[from]-i];
@@ -149,8 +237,11 @@ void FortyeightSolver::make_move(MOVE *m)
     Wlen[from] -= m->card_index+1;
 
     hashpile(from);
-    if ( m->totype != O_Type )
+    if ( m->totype != O_Type ) {
       hashpile(to);
+      growpile(to, m->card_index+1);
+    }
+    checkpiles();
 #if PRINT
     print_layout();
 #endif
@@ -207,6 +298,8 @@ void FortyeightSolver::undo_move(MOVE *m)
         return;
     }
 
+    if ( m->totype != O_Type )
+      shrinkpile(to, m->card_index+1);
     for ( int i = m->card_index + 1; i > 0; --i )
     {
       
@@ -228,10 +321,13 @@ void FortyeightSolver::undo_move(MOVE *m)
     }
 
     hashpile(from);
+    if ( from < 8 )
+      growpile(from, m->card_index+1);
     if ( m->totype != O_Type ) {
       Wlen[to] -= m->card_index+1;
       hashpile(to);
     }
+    checkpiles();
 #if PRINT
     print_layout();
 #endif
@@ -362,11 +458,19 @@ int FortyeightSolver::get_possible_moves(int *a, int *numout)
     //fprintf(stderr, "\n");
     *numout = n;
 
+    // the piles with each card on top, the first empty one takes anything
+    quint8 takes[64] = { 0 };
+    for ( int j = 0; j < 8; j++ )
+        if ( Wlen[j] )
+            takes[*Wp[j] & 0x3F] |= 1 << j;
+    const quint8 empty = d.firstempty < 0 ? 0 : 1 << d.firstempty;
+
     for (int w = 0; w < 8; w++)
     {
+        const quint8 targets = Wlen[w] ? takes[(*Wp[w] & 0x3F) + 1] | empty : 0;
         for ( int j = 0; j < 8; j++ )
         {
-            if ( j == w )
+            if ( !( targets & ( 1 << j ) ) )
                 continue;
             if ( checkMove( w, j, mp ) )
             {
@@ -416,10 +520,7 @@ int FortyeightSolver::get_possible_moves(int *a, int *numout)
             // column, so we can try for multi-card moves from w to other cols.
             // This is valid only if ALL the cards to move are of the same
             // suit and in ascending sequence, starting with the top two cards.
-            const card_t nextw = W[w][Wlen[w]-2];	// Next card after top.
-            const bool possMultiMove = ( SUIT( nextw ) == SUIT( *Wp[w] ) ) &&
-                                       ( ( RANK( nextw ) - RANK( *Wp[w] ) ) == 1 );
-            if ( possMultiMove )
+            if ( Srun[w] > 1 )
             {
                 //print_layout();
 
@@ -438,19 +539,12 @@ int FortyeightSolver::get_possible_moves(int *a, int *numout)
                     if ( moves >= Wlen[w] )
                         moves = Wlen[w];
 
+                    // only the cards in sequence on top go together
                     bool switched = false;
-                    for ( int i = 2; i < moves; ++i )
+                    if ( Srun[w] < moves )
                     {
-                        /*      printcard( W[w][Wlen[w]-i-1], stderr );
-                        printcard( *Wp[w], stderr );
-                        fprintf( stderr, " switch? %d\n", i ); */
-		      if ( SUIT( W[w][Wlen[w]-i-1] ) != SUIT( *Wp[w] ) ||
-			   RANK ( W[w][Wlen[w]-i-1] ) != RANK ( W[w][Wlen[w]-i] ) + 1)
-			{
-                            switched = true;
-                            moves = i;
-                            break;
-                        }
+                        switched = true;
+                        moves = Srun[w];
                     }
                     if ( !Wlen[to] )
 		      {
@@ -535,6 +629,16 @@ void FortyeightSolver::unpack_cluster( unsigned int k )
     O[6] = k & 0xF;
     k >>= 4;
     O[7] = k & 0xF;
+
+    for ( int w = 0; w < 8; ++w )
+    {
+        if ( Spile[w] != Wpilenum[w] )
+        {
+            sumpile( w );
+            Spile[w] = Wpilenum[w];
+        }
+    }
+    checkpiles();
 }
 
 bool FortyeightSolver::isWon()
@@ -560,6 +664,11 @@ FortyeightSolver::FortyeightSolver(const Fortyeight *dealer)
     deal = dealer;
 }
 
+FortyeightSolver *FortyeightSolver::clone() const
+{
+    return new FortyeightSolver( *this );
+}
+
 void FortyeightSolver::translate_layout()
 {
     /* Read the workspace. */
@@ -614,6 +723,11 @@ void FortyeightSolver::translate_layout()
 
     lastdeal = deal->lastdeal;
 
+    for ( int w = 0; w < 8; ++w ) {
+        sumpile( w );
+        Spile[w] = -1;
+    }
+
     Q_ASSERT( total == 104 );
 }
 
@@ -630,6 +744,15 @@ unsigned int FortyeightSolver::getClusterNumber()
     return k;
 }
 
+/* The eight tableau piles are interchangeable; the deck and the waste
+only ever deal to the waste. */
+
+const quint8 *FortyeightSolver::pile_classes() const
+{
+    static const quint8 classes[10] = { 1, 1, 1, 1, 1, 1, 1, 1, 0, 0 };
+    return classes;
+}
+
 MoveHint FortyeightSolver::translateMove( const MOVE &m )
 {
     if ( m.from == NUM_DECK || m.to == NUM_DECK )
@@ -28,6 +28,7 @@ class FortyeightSolver : public Solver<10>
 {
 public:
     explicit FortyeightSolver(const Fortyeight *dealer);
+    FortyeightSolver *clone() const override;
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
     void make_move(MOVE *m) override;
@@ -36,10 +37,15 @@ public:
     unsigned int getClusterNumber() override;
     void translate_layout() override;
     void unpack_cluster( unsigned int k ) override;
+    const quint8 *pile_classes() const override;
     MoveHint translateMove(const MOVE &m) override;
     bool checkMove( int from, int to, MOVE *mp );
     bool checkMoveOut( int from, MOVE *mp, int *dropped );
     void checkState(FortyeightSolverState &d);
+    void sumpile(int w);
+    void growpile(int w, int n);
+    void shrinkpile(int w, int n);
+    void checkpiles();
 
     void print_layout() override;
 
@@ -49,6 +55,17 @@ public:
     card_t O[8]; /* output piles store only the rank or NONE */
     card_t Osuit[8];
 
+    /* What checkState() needs to know of the tableau piles, kept up to
+    date as cards come and go instead of looking at all the cards for
+    every position: the cards in suit sequence on top, the sum of their
+    scores, and that of the cards below them.  Spile is the id of the pile
+    this was summed up for, so unpack_cluster() only has to look at piles
+    that changed; -1 for piles changed since.  The ids are only good for
+    one search, translate_layout() starts over. */
+    int Srun[8];
+    int Srunscore[8];
+    int Sbelow[8];
+    int Spile[8];
 };
 
 #endif // FORTYEIGHTSOLVER_H
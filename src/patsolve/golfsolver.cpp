@@ -20,6 +20,10 @@
 // own
 #include "../golf.h"
 #include "../kpat_debug.h"
+#include "stateset.h"
+// Std
+#include <algorithm>
+#include <vector>
 
 const int CHUNKSIZE = 10000;
 
@@ -232,11 +236,13 @@ void GolfSolver::free_solver_instance()
     }
 }
 
-SolverInterface::ExitStatus GolfSolver::patsolve( int _max_positions )
+SolverInterface::ExitStatus GolfSolver::search( int _max_positions )
 {
     int current_iters_count = 0;
     max_positions = (_max_positions < 0) ? default_max_positions : _max_positions;
     init();
+    /* Black Hole Solver keeps its own positions. */
+    free();
 
     if (solver_instance)
     {
@@ -289,13 +295,18 @@ black_hole_solver_setup(solver_instance);
             solver_ret = black_hole_solver_run(solver_instance);
             {
                 // QMutexLocker lock( &endMutex );
-                if ( m_shouldEnd )
+                if ( m_shouldEnd || End.hasExpired() )
                 {
                     continue_loop = false;
                 }
             }
         }
     }
+    if ( solver_ret == BLACK_HOLE_SOLVER__OUT_OF_ITERS && !m_shouldEnd && End.hasExpired() )
+    {
+        free_solver_instance();
+        return Solver::DeadlineReached;
+    }
     switch (solver_ret)
     {
         case BLACK_HOLE_SOLVER__OUT_OF_ITERS:
@@ -338,6 +349,163 @@ black_hole_solver_setup(solver_instance);
 }
 #endif
 
+#ifndef WITH_BH_SOLVER
+/* The dedicated search, see setDedicatedSearch().  Cards only ever leave
+the columns and the deck, so a position is no more than the depths of the
+seven columns, three bits each, the six bit length of the deck, and the
+rank on top of the pile: that is its key, and there is nothing to unpack.
+It makes the moves of get_possible_moves(), depth first, the aces and
+kings first. */
+
+namespace {
+struct GolfFrame {
+    quint8 moves[8];        /* columns, or 8 for the deck */
+    quint8 n;
+    quint8 next;            /* the move made, plus one */
+    quint8 top;             /* the rank on the pile before it */
+};
+}
+
+SolverInterface::ExitStatus GolfSolver::search( int _max_positions )
+{
+    if ( !Dedicated )
+        return Solver::search( _max_positions );
+    begin_dedicated( _max_positions );
+
+    int len[7], decklen = Wlen[8];
+    int top = Wlen[7] ? RANK( *Wp[7] ) : 0;
+    for ( int w = 0; w < 7; ++w )
+    {
+        Q_ASSERT( Wlen[w] < 8 );
+        len[w] = Wlen[w];
+    }
+    Q_ASSERT( decklen < 64 );
+
+    auto key = [&]() {
+        quint64 k = decklen | top << 6;
+        for ( int w = 0; w < 7; ++w )
+            k = k << 3 | len[w];
+        return k;
+    };
+    auto generate = [&]( GolfFrame *f ) {
+        f->n = 0;
+        f->next = 0;
+        for ( int pass = 0; pass < 2 && top; ++pass )
+            for ( int w = 0; w < 7; ++w )
+            {
+                if ( !len[w] )
+                    continue;
+                const int rank = RANK( W[w][len[w] - 1] );
+                const bool end = rank == PS_ACE || rank == PS_KING;
+                if ( ( rank == top - 1 || rank == top + 1 ) && end == ( pass == 0 ) )
+                    f->moves[f->n++] = w;
+            }
+        if ( !f->n && decklen )
+            f->moves[f->n++] = 8;
+    };
+    auto won = [&]() {
+        return !decklen && std::all_of( len, len + 7, []( int l ) { return l == 0; } );
+    };
+    auto move = [&]( int from ) {
+        MOVE m;
+        m.card_index = from == 8 ? 1 : 0;
+        m.from = from;
+        m.to = 7;
+        m.totype = W_Type;
+        m.turn_index = from == 8 ? 0 : -1;
+        m.pri = from == 8 ? 5 : 13;
+        if ( from < 7 && ( RANK( W[from][len[from] - 1] ) == PS_ACE || RANK( W[from][len[from] - 1] ) == PS_KING ) )
+            m.pri = 30;
+        return m;
+    };
+
+    StateSet seen( mm.get() );
+    std::vector<GolfFrame> stack( 1 );
+    if ( seen.visit( key() ) == MemoryManager::ERR )
+        return Status = UnableToDetermineSolvability;
+    Total_positions = 1;
+    Total_moves = 1;
+    generate( &stack[0] );
+    for ( int i = 0; i < stack[0].n; ++i )
+        m_firstMoves.append( move( stack[0].moves[i] ) );
+    if ( !stack[0].n && won() )
+        return Status = SolutionExists;
+
+    while ( !stack.empty() && !dedicated_done() )
+    {
+        GolfFrame *f = &stack.back();
+
+        /* Take back the move of the frame, if any, and make the next. */
+
+        if ( f->next )
+        {
+            const int from = f->moves[f->next - 1];
+            if ( from == 8 )
+                decklen++;
+            else
+                len[from]++;
+            top = f->top;
+        }
+        if ( f->next == f->n )
+        {
+            stack.pop_back();
+            continue;
+        }
+        const int from = f->moves[f->next++];
+        f->top = top;
+        if ( from == 8 )
+            top = RANK( W[8][--decklen] );
+        else
+            top = RANK( W[from][--len[from]] );
+
+        Total_generated++;
+        const MemoryManager::inscode i = seen.visit( key() );
+        if ( i == MemoryManager::FOUND )
+            continue;
+        if ( i == MemoryManager::ERR )
+        {
+            Status = UnableToDetermineSolvability;
+            break;
+        }
+        Total_positions++;
+        Total_moves++;
+
+        stack.emplace_back();
+        f = &stack.back();
+        generate( f );
+        Max_frontier = qMax<unsigned long>( Max_frontier, stack.size() );
+        if ( !f->n )
+        {
+            stack.pop_back();
+            if ( won() )
+            {
+                Status = SolutionExists;
+                break;
+            }
+        }
+    }
+
+    /* Every frame made one move on the way to a win; take them back to
+    read them off. */
+
+    if ( Status == SolutionExists )
+    {
+        for ( int j = stack.size() - 1; j >= 0; --j )
+        {
+            const int from = stack[j].moves[stack[j].next - 1];
+            if ( from == 8 )
+                decklen++;
+            else
+                len[from]++;
+            m_winMoves.insert( 0, move( from ) );
+        }
+    }
+    else if ( Status == SearchAborted )
+        m_firstMoves.clear();
+    return Status;
+}
+#endif
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
 card).  Temp cells and Out on the last two lines, if any. */
 
@@ -35,10 +35,12 @@ public:
     explicit GolfSolver(const Golf *dealer);
     int default_max_positions;
 
+    SolverInterface::ExitStatus search( int _max_positions ) override;
 #ifdef WITH_BH_SOLVER
     black_hole_solver_instance_t *solver_instance;
     int solver_ret;
-    SolverInterface::ExitStatus patsolve( int _max_positions ) override;
+    QVector<qreal> parameters() const override { return {}; }
+    void setParameters(const QVector<qreal> &) override {}
     // More than enough space for two decks.
     char board_as_string[4 * 13 * 2 * 4 * 3];
     void free_solver_instance();
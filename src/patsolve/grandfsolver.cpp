@@ -162,7 +162,7 @@ void GrandfSolver::make_move(MOVE *m)
         else
             W[offs][to]++;
         Q_ASSERT( m->card_index == 0 );
-        hashpile( offs );
+        rehashpile( offs, to );
     } else {
         hashpile(to);
     }
@@ -219,6 +219,7 @@ void GrandfSolver::undo_move(MOVE *m)
     if (m->totype == O_Type) {
         card = W[offs][Osuit[to]];
         W[offs][to]--;
+        rehashpile( offs, to );
         Wp[from]++;
         *Wp[from] = card;
         Wlen[from]++;
@@ -413,6 +414,11 @@ GrandfSolver::GrandfSolver(const Grandf *dealer)
     m_redeal = -1;
 }
 
+GrandfSolver *GrandfSolver::clone() const
+{
+    return new GrandfSolver( *this );
+}
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
 card).  Temp cells and Out on the last two lines, if any. */
 
@@ -27,6 +27,7 @@ class GrandfSolver : public Solver<7*3+1>
 {
 public:
     explicit GrandfSolver(const Grandf *dealer);
+    GrandfSolver *clone() const override;
 
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
@@ -440,6 +440,18 @@ int GypsySolver::getOuts()
     return k;
 }
 
+/* The cluster adds up the ranks on the two foundations of each suit,
+five bits per suit, so it doesn't matter which of the two took a card. */
+
+unsigned int GypsySolver::getClusterNumber()
+{
+    unsigned int k = 0;
+    for (int o = 0; o < 8; ++o)
+        if ( Wlen[outs + o] )
+            k += RANK( *Wp[outs + o] ) << ( ( o / 2 ) * 5 );
+    return k;
+}
+
 GypsySolver::GypsySolver(const Gypsy *dealer)
     : Solver()
 {
@@ -461,6 +473,28 @@ GypsySolver::GypsySolver(const Gypsy *dealer)
     }
 }
 
+/* params[5] scales the bonus for long sequences, the others are move
+priorities. */
+
+QVector<qreal> GypsySolver::moveParameters() const
+{
+    QVector<qreal> p;
+    for ( int param : params )
+        p.append( param );
+    return p;
+}
+
+void GypsySolver::setMoveParameters(const QVector<qreal> &p)
+{
+    for ( int i = 0; i < qMin( p.size(), 6 ); ++i )
+        params[i] = i == 5 ? qRound( p[i] ) : movePriority( p[i] );
+}
+
+GypsySolver *GypsySolver::clone() const
+{
+    return new GypsySolver( *this );
+}
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
    card).  Temp cells and Out on the last two lines, if any. */
 
@@ -526,6 +560,17 @@ void GypsySolver::print_layout()
     return;
 }
 
+/* The two foundations of a suit are interchangeable, and so are the
+tableau piles once the deck, which deals to each of them in turn, is
+empty. */
+
+const quint8 *GypsySolver::pile_classes() const
+{
+    static const quint8 dealing[17] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 3, 3, 4, 4, 5, 5 };
+    static const quint8 dealt[17] = { 1, 1, 1, 1, 1, 1, 1, 1, 0, 2, 2, 3, 3, 4, 4, 5, 5 };
+    return Wlen[deck] ? dealing : dealt;
+}
+
 MoveHint GypsySolver::translateMove( const MOVE &m )
 {
     //print_layout();
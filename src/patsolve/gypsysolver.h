@@ -27,14 +27,19 @@ class GypsySolver : public Solver<8 + 1 + 8>
 {
 public:
     explicit GypsySolver(const Gypsy *dealer);
+    GypsySolver *clone() const override;
     int good_automove(int o, int r);
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
     void make_move(MOVE *m) override;
     void undo_move(MOVE *m) override;
     int getOuts() override;
+    unsigned int getClusterNumber() override;
     void translate_layout() override;
+    const quint8 *pile_classes() const override;
     MoveHint translateMove(const MOVE &m) override;
+    QVector<qreal> moveParameters() const override;
+    void setMoveParameters(const QVector<qreal> &p) override;
 
     void print_layout() override;
 
@@ -20,6 +20,9 @@
 // own
 #include "../idiot.h"
 #include "../kpat_debug.h"
+#include "stateset.h"
+// Std
+#include <vector>
 
 #define PRINT 0
 
@@ -197,12 +200,22 @@ int IdiotSolver::getOuts()
     return Wlen[5];
 }
 
+unsigned int IdiotSolver::getClusterNumber()
+{
+    return Wlen[5];
+}
+
 IdiotSolver::IdiotSolver(const Idiot *dealer)
     : Solver()
 {
     deal = dealer;
 }
 
+IdiotSolver *IdiotSolver::clone() const
+{
+    return new IdiotSolver( *this );
+}
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
 card).  Temp cells and Out on the last two lines, if any. */
 
@@ -300,3 +313,185 @@ bool IdiotSolver::canMoveAway(int pile ) const
              ( Wlen[2] && higher( *Wp[pile], *Wp[2] ) ) ||
              ( Wlen[3] && higher( *Wp[pile], *Wp[3] ) ) );
 }
+
+/* The dedicated search, see setDedicatedSearch().  A position is the
+cards of the four columns and the length of the deck, which is all that
+decides what can still be done; what went away doesn't.  Its key is a
+fingerprint made of one random number for every card at every place in
+the columns, kept up to date as cards come and go.  It makes the moves
+of get_possible_moves(), depth first, but fills empty columns before it
+deals. */
+
+namespace {
+struct IdiotMove {
+    quint8 from, to;
+};
+
+struct IdiotFrame {
+    IdiotMove moves[16];
+    quint8 n;
+    quint8 next;            /* the move made, plus one */
+    card_t card;            /* the card it sent away, if it did */
+};
+
+quint64 mix( quint64 x )
+{
+    x += Q_UINT64_C(0x9E3779B97F4A7C15);
+    x = ( x ^ ( x >> 30 ) ) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+    x = ( x ^ ( x >> 27 ) ) * Q_UINT64_C(0x94D049BB133111EB);
+    return x ^ ( x >> 31 );
+}
+}
+
+SolverInterface::ExitStatus IdiotSolver::search( int _max_positions )
+{
+    if ( !Dedicated )
+        return Solver::search( _max_positions );
+    begin_dedicated( _max_positions );
+
+    card_t cols[4][52];
+    int len[4] = { 0, 0, 0, 0 };
+    int decklen = Wlen[4], out = Wlen[5];
+    quint64 fp = 0;
+
+    auto push = [&]( int w, card_t card ) {
+        cols[w][len[w]] = card;
+        fp ^= mix( card << 8 | w << 6 | len[w] );
+        len[w]++;
+    };
+    auto pop = [&]( int w ) {
+        len[w]--;
+        const card_t card = cols[w][len[w]];
+        fp ^= mix( card << 8 | w << 6 | len[w] );
+        return card;
+    };
+    auto key = [&]() {
+        return fp ^ mix( 1 << 16 | decklen );
+    };
+    auto generate = [&]( IdiotFrame *f ) {
+        f->n = 0;
+        f->next = 0;
+        for ( int i = 0; i < 4; ++i )
+            for ( int j = 0; j < 4 && len[i]; ++j )
+                if ( len[j] && higher( cols[i][len[i] - 1], cols[j][len[j] - 1] ) )
+                {
+                    f->moves[f->n++] = { quint8( i ), 5 };
+                    return;
+                }
+        for ( int i = 0; i < 4; ++i )
+            for ( int j = 0; j < 4 && !len[i]; ++j )
+                if ( i != j && len[j] )
+                    f->moves[f->n++] = { quint8( j ), quint8( i ) };
+        if ( decklen )
+            f->moves[f->n++] = { 4, 0 };
+    };
+    auto make = [&]( IdiotFrame *f, const IdiotMove &m ) {
+        if ( m.to == 5 )
+        {
+            f->card = pop( m.from );
+            out++;
+        }
+        else if ( m.from == 4 )
+        {
+            Q_ASSERT( decklen >= 4 );
+            for ( int i = 0; i < 4; ++i )
+            {
+                const card_t card = W[4][--decklen];
+                push( i, ( SUIT( card ) << 4 ) + RANK( card ) );
+            }
+        }
+        else
+            push( m.to, pop( m.from ) );
+    };
+    auto undo = [&]( const IdiotFrame *f, const IdiotMove &m ) {
+        if ( m.to == 5 )
+        {
+            push( m.from, f->card );
+            out--;
+        }
+        else if ( m.from == 4 )
+        {
+            for ( int i = 3; i >= 0; --i )
+            {
+                pop( i );
+                decklen++;
+            }
+        }
+        else
+            push( m.from, pop( m.to ) );
+    };
+    auto move = []( const IdiotMove &m ) {
+        MOVE mv;
+        mv.card_index = 0;
+        mv.from = m.from;
+        mv.to = m.to;
+        mv.totype = W_Type;
+        mv.turn_index = m.to == 5 ? -1 : 0;
+        mv.pri = m.to == 5 ? 30 : 2;
+        return mv;
+    };
+
+    for ( int w = 0; w < 4; ++w )
+        for ( int i = 0; i < Wlen[w]; ++i )
+            push( w, W[w][i] );
+
+    StateSet seen( mm.get() );
+    std::vector<IdiotFrame> stack( 1 );
+    if ( seen.visit( key() ) == MemoryManager::ERR )
+        return Status = UnableToDetermineSolvability;
+    Total_positions = 1;
+    Total_moves = 1;
+    generate( &stack[0] );
+    for ( int i = 0; i < stack[0].n; ++i )
+        m_firstMoves.append( move( stack[0].moves[i] ) );
+    if ( out == 48 )
+        return Status = SolutionExists;
+
+    while ( !stack.empty() && !dedicated_done() )
+    {
+        IdiotFrame *f = &stack.back();
+
+        /* Take back the move of the frame, if any, and make the next. */
+
+        if ( f->next )
+            undo( f, f->moves[f->next - 1] );
+        if ( f->next == f->n )
+        {
+            stack.pop_back();
+            continue;
+        }
+        make( f, f->moves[f->next++] );
+
+        Total_generated++;
+        const MemoryManager::inscode i = seen.visit( key() );
+        if ( i == MemoryManager::FOUND )
+            continue;
+        if ( i == MemoryManager::ERR )
+        {
+            Status = UnableToDetermineSolvability;
+            break;
+        }
+        Total_positions++;
+        Total_moves++;
+        if ( out == 48 )
+        {
+            Status = SolutionExists;
+            break;
+        }
+
+        stack.emplace_back();
+        generate( &stack.back() );
+        Max_frontier = qMax<unsigned long>( Max_frontier, stack.size() );
+        if ( !stack.back().n )
+            stack.pop_back();
+    }
+
+    if ( Status == SolutionExists )
+    {
+        for ( const IdiotFrame &f : stack )
+            m_winMoves.append( move( f.moves[f.next - 1] ) );
+    }
+    else if ( Status == SearchAborted )
+        m_firstMoves.clear();
+    return Status;
+}
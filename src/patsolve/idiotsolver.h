@@ -27,11 +27,14 @@ class IdiotSolver : public Solver<6>
 {
 public:
     explicit IdiotSolver(const Idiot *dealer);
+    IdiotSolver *clone() const override;
+    SolverInterface::ExitStatus search( int _max_positions ) override;
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
     void make_move(MOVE *m) override;
     void undo_move(MOVE *m) override;
     int getOuts() override;
+    unsigned int getClusterNumber() override;
     void translate_layout() override;
     MoveHint translateMove(const MOVE &m) override;
 
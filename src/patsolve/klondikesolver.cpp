@@ -20,6 +20,8 @@
 // own
 #include "../klondike.h"
 #include "../kpat_debug.h"
+// Std
+#include <cstring>
 
 /* Some macros used in get_possible_moves(). */
 
@@ -50,44 +52,44 @@ void KlondikeSolver::make_move(MOVE *m)
 	from = m->from;
 	to = m->to;
 
-	/* Remove from pile. */
+	/* Dealing and redealing only move the cursor. */
         if ( from == 7 && to == 8 )
         {
-            while ( Wlen[7] )
-            {
-                card = W[7][Wlen[7]-1] + ( 1 << 7 );
-                Wlen[8]++;
-                W[8][Wlen[8]-1] = card;
-                Wlen[7]--;
-            }
-            Wp[7] = &W[7][0];
-            Wp[8] = &W[8][Wlen[8]-1];
-            hashpile( 7 );
-            hashpile( 8 );
+            m_waste = 0;
 #if PRINT
             print_layout();
 #endif
             return;
         }
 
-        // move to pile
         if ( from == 8 && to == 7 )
         {
-            for ( int i = 0; i < m->card_index; ++i )
-            {
-                if ( !Wlen[8] )
-                    continue;
+            m_waste += m->card_index;
+            Q_ASSERT( m_waste <= Wlen[7] );
+#if PRINT
+            print_layout();
+#endif
+            return;
+        }
 
-                card = *Wp[8];
-                Wp[8]--;
-                Wlen[8]--;
-                card = ( SUIT( card ) << 4 ) + RANK( card );
-                Wp[7]++;
-                *Wp[7] = card;
-                Wlen[7]++;
+        /* The top card of the waste is in the middle of the talon. */
+        if ( from == 7 )
+        {
+            card = W[7][m_waste-1];
+            memmove( &W[7][m_waste-1], &W[7][m_waste], Wlen[7] - m_waste );
+            Wlen[7]--;
+            Wp[7]--;
+            /* Every card from there on moved down. */
+            rehashpile( 7, m_waste - 1 );
+            m_waste--;
+            if ( m->totype == O_Type ) {
+                O[to]++;
+            } else {
+                Wp[to]++;
+                *Wp[to] = card;
+                Wlen[to]++;
+                hashpile( to );
             }
-            hashpile( 7 );
-            hashpile( 8 );
 #if PRINT
             print_layout();
 #endif
@@ -152,49 +154,48 @@ void KlondikeSolver::undo_move(MOVE *m)
 	from = m->from;
 	to = m->to;
 
-	/* Remove from 'to' pile. */
-
         if ( from == 7 && to == 8 )
         {
-            while ( Wlen[8] )
-            {
-                card = W[8][Wlen[8]-1];
-                card = ( SUIT( card ) << 4 ) + RANK( card );
-                Wlen[7]++;
-                W[7][Wlen[7]-1] = card;
-                Wlen[8]--;
-            }
-            Wp[8] = &W[8][0];
-            Wp[7] = &W[7][Wlen[7]-1];
-            hashpile( 7 );
-            hashpile( 8 );
+            m_waste = Wlen[7];
 #if PRINT
             print_layout();
 #endif
             return;
         }
 
-        // move back to deck
         if ( from == 8 && to == 7 )
         {
-            for ( int i = 0; i < m->card_index; ++i )
-            {
-                card = *Wp[7];
-                Wp[7]--;
-                Wlen[7]--;
-                card = ( SUIT( card ) << 4 ) + RANK( card ) + ( 1 << 7 );
-                Wp[8]++;
-                *Wp[8] = card;
-                Wlen[8]++;
+            m_waste -= m->card_index;
+#if PRINT
+            print_layout();
+#endif
+            return;
+        }
+
+        if ( from == 7 )
+        {
+            if ( m->totype == O_Type ) {
+                card = O[to] + Osuit[to];
+                O[to]--;
+            } else {
+                card = *Wp[to];
+                Wp[to]--;
+                Wlen[to]--;
+                hashpile( to );
             }
-            hashpile( 7 );
-            hashpile( 8 );
+            memmove( &W[7][m_waste+1], &W[7][m_waste], Wlen[7] - m_waste );
+            W[7][m_waste] = card;
+            Wlen[7]++;
+            Wp[7]++;
+            rehashpile( 7, m_waste );
+            m_waste++;
 #if PRINT
             print_layout();
 #endif
             return;
         }
 
+	/* Remove from 'to' pile. */
 
         /* Add to 'from' pile. */
         if ( m->turn_index > 0 )
@@ -295,8 +296,8 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
     int n = 0;
     mp = Possible;
     for (w = 0; w < 8; ++w) {
-        if (Wlen[w] > 0) {
-            card = *Wp[w];
+        if (w == 7 ? m_waste > 0 : Wlen[w] > 0) {
+            card = w == 7 ? W[7][m_waste-1] : *Wp[w];
             o = SUIT(card);
             empty = (O[o] == NONE);
             if ((empty && (RANK(card) == PS_ACE)) ||
@@ -307,7 +308,7 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
                 mp->totype = O_Type;
                 mp->pri = 3;    /* unused */
                 mp->turn_index = -1;
-                if ( Wlen[w] > 1 && DOWN( W[w][Wlen[w]-2] ) )
+                if ( w < 7 && Wlen[w] > 1 && DOWN( W[w][Wlen[w]-2] ) )
                     mp->turn_index = 1;
                 n++;
                 mp++;
@@ -315,7 +316,7 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
                 /* If it's an automove, just do it. Automoves from the pile are problematic though
 		   in draw=3 because automoves can break the offset and break winnable games 
 		 */
-                if (good_automove(o, RANK(card)) && (w != 7 || m_draw == 1 || Wlen[7] < 3)) {
+                if (good_automove(o, RANK(card)) && (w != 7 || m_draw == 1 || m_waste < 3)) {
                     *a = true;
                     mp[-1].pri = 127;
                     if (n != 1) {
@@ -334,12 +335,12 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
     *numout = n;
 
     /* check for deck->pile */
-    if ( Wlen[8] ) {
-        mp->card_index = qMin( m_draw, Wlen[8] );
+    if ( m_waste < Wlen[7] ) {
+        mp->card_index = qMin( m_draw, Wlen[7] - m_waste );
         mp->from = 8;
         mp->to = 7;
         mp->totype = W_Type;
-        mp->pri = 5;
+        mp->pri = m_pri[3];
         mp->turn_index = 0;
         n++;
         mp++;
@@ -348,7 +349,7 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
     // we first check where to put a king, so we don't
     // try each king on each empty pile
     int first_empty_pile = -1;
-    for(int i=0; i<8; ++i)
+    for(int i=0; i<7; ++i)
         if ( !Wlen[i] )
         {
             first_empty_pile = i;
@@ -358,11 +359,11 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
     for(int i=0; i<8; ++i)
     {
         int len = Wlen[i];
-        if ( i == 7 && Wlen[i] > 0)
-            len = 1;
+        if ( i == 7 )
+            len = qMin( m_waste, 1 );
         for (int l=0; l < len; ++l )
         {
-            card_t card = W[i][Wlen[i]-1-l];
+            card_t card = i == 7 ? W[7][m_waste-1] : W[i][Wlen[i]-1-l];
             if ( DOWN( card ) )
                 break;
 
@@ -378,7 +379,7 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
                      suitable( card, *Wp[j] ) )
                 {
                     allowed = 1;
-                    if ( Wlen[i] == l + 1 ) {
+                    if ( Wlen[i] == l + 1 || i == 7 ) {
                         allowed = 2;
                     } else {
                         if ( DOWN( W[i][Wlen[i]-l-2] ) )
@@ -413,15 +414,15 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
                     mp->to = j;
                     mp->totype = W_Type;
                     mp->turn_index = -1;
-                    if ( Wlen[i] > l+1 && DOWN( W[i][Wlen[i]-l-2] ) )
+                    if ( i < 7 && Wlen[i] > l+1 && DOWN( W[i][Wlen[i]-l-2] ) )
                         mp->turn_index = 1;
                     if ( i == 7 )
-                        mp->pri = 40;
+                        mp->pri = m_pri[0];
                     else {
                         if ( mp->turn_index > 0 || Wlen[i] == l+1)
-                            mp->pri = 30;
+                            mp->pri = m_pri[1];
                         else
-                            mp->pri = 1;
+                            mp->pri = m_pri[2];
                     }
                     n++;
                     mp++;
@@ -430,14 +431,14 @@ int KlondikeSolver::get_possible_moves(int *a, int *numout)
         }
     }
 
-    if ( Wlen[8] == 0 && Wlen[7] > 1 )
+    if ( m_waste == Wlen[7] && m_waste > 1 )
     {
         mp->card_index = 0;
         mp->from = 7;
         mp->to = 8;
         mp->totype = W_Type;
         mp->turn_index = 0;
-        mp->pri = 2;
+        mp->pri = m_pri[4];
         n++;
         mp++;
     }
@@ -454,6 +455,8 @@ void KlondikeSolver::unpack_cluster( unsigned int k )
     O[2] = k & 0xF;
     k >>= 4;
     O[3] = k & 0xF;
+    k >>= 4;
+    m_waste = k;
 }
 
 bool KlondikeSolver::isWon()
@@ -473,8 +476,15 @@ int KlondikeSolver::getOuts()
     return O[0] + O[1] + O[2] + O[3];
 }
 
+/* The cards of the talon are taken to be free; only the columns count. */
+
+bool KlondikeSolver::dead_deal()
+{
+    return stuck_card(7);
+}
+
 KlondikeSolver::KlondikeSolver(const Klondike *dealer, int draw)
-    : Solver(), m_draw( draw )
+    : Solver(), m_waste( 0 ), m_draw( draw )
 {
     Osuit[0] = PS_DIAMOND;
     Osuit[1] = PS_CLUB;
@@ -484,6 +494,25 @@ KlondikeSolver::KlondikeSolver(const Klondike *dealer, int draw)
     deal = dealer;
 }
 
+QVector<qreal> KlondikeSolver::moveParameters() const
+{
+    QVector<qreal> p;
+    for ( int pri : m_pri )
+        p.append( pri );
+    return p;
+}
+
+void KlondikeSolver::setMoveParameters(const QVector<qreal> &p)
+{
+    for ( int i = 0; i < qMin( p.size(), int( m_pri.size() ) ); ++i )
+        m_pri[i] = movePriority( p[i] );
+}
+
+KlondikeSolver *KlondikeSolver::clone() const
+{
+    return new KlondikeSolver( *this );
+}
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
 card).  Temp cells and Out on the last two lines, if any. */
 
@@ -499,15 +528,19 @@ void KlondikeSolver::translate_layout()
         total += i;
     }
 
+    /* The talon, see m_waste.  Pile 8 takes the stock for a moment. */
     int i = translate_pile( deal->pile, W[7], 52 );
-    Wp[7] = &W[7][i-1];
-    Wlen[7] = i;
-    total += i;
-
-    i = translate_pile( deal->talon, W[8], 52 );
-    Wp[8] = &W[8][i-1];
-    Wlen[8] = i;
-    total += i;
+    int j = translate_pile( deal->talon, W[8], 52 );
+    for ( int l = 0; l < j; ++l )
+        W[7][i + l] = W[8][j - l - 1];
+    for ( int l = 0; l < i + j; ++l )
+        W[7][l] = ( SUIT( W[7][l] ) << 4 ) + RANK( W[7][l] );
+    m_waste = i;
+    Wlen[7] = i + j;
+    Wp[7] = &W[7][Wlen[7]-1];
+    Wlen[8] = 0;
+    Wp[8] = &W[8][-1];
+    total += i + j;
 
     /* Output piles, if any. */
     for (int i = 0; i < 4; ++i) {
@@ -531,7 +564,7 @@ unsigned int KlondikeSolver::getClusterNumber()
     unsigned int k = i;
     i = O[2] + (O[3] << 4);
     k |= i << 8;
-    return k;
+    return k | m_waste << 16;
 }
 
 MoveHint KlondikeSolver::translateMove( const MOVE &m )
@@ -582,14 +615,21 @@ void KlondikeSolver::print_layout()
 
     fprintf(stderr, "print-layout-begin\n");
     for (w = 0; w < 9; ++w) {
-        if ( w == 8 )
+        if ( w == 8 ) {
             fprintf( stderr, "Deck: " );
-        else if ( w == 7 )
+            for (i = Wlen[7] - 1; i >= m_waste; --i) {
+                printcard(W[7][i], stderr);
+            }
+        } else if ( w == 7 ) {
             fprintf( stderr, "Pile: " );
-        else
+            for (i = 0; i < m_waste; ++i) {
+                printcard(W[7][i], stderr);
+            }
+        } else {
             fprintf( stderr, "Play%d: ", w );
-        for (i = 0; i < Wlen[w]; ++i) {
-            printcard(W[w][i], stderr);
+            for (i = 0; i < Wlen[w]; ++i) {
+                printcard(W[w][i], stderr);
+            }
         }
         fputc('\n', stderr);
     }
@@ -27,6 +27,7 @@ class KlondikeSolver : public Solver<9>
 {
 public:
     KlondikeSolver(const Klondike *dealer, int draw);
+    KlondikeSolver *clone() const override;
     int good_automove(int o, int r);
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
@@ -36,7 +37,11 @@ public:
     unsigned int getClusterNumber() override;
     void translate_layout() override;
     void unpack_cluster( unsigned int k ) override;
+    bool dead_deal() override;
+    unsigned int out_bits() const override { return 0xFFFF; }
     MoveHint translateMove(const MOVE &m) override;
+    QVector<qreal> moveParameters() const override;
+    void setMoveParameters(const QVector<qreal> &p) override;
 
     void print_layout() override;
 
@@ -45,8 +50,18 @@ public:
     card_t O[4]; /* output piles store only the rank or NONE */
     card_t Osuit[4];
 
+    /* The talon is pile 7: the waste from the bottom up, followed by the
+    stock from the top down, so dealing and redealing keep the order.  The
+    first m_waste cards are the waste; the cluster has that number, and
+    pile 8 stays empty. */
+    int m_waste;
+
     const Klondike *deal;
     int m_draw;
+
+    /* Move priorities: from the waste, turning a card or emptying a
+    pile, other moves between piles, dealing, and redealing. */
+    std::array<int, 5> m_pri = {{ 40, 30, 1, 5, 2 }};
 };
 
 #endif // KLONDIKESOLVER_H
@@ -19,140 +19,223 @@
 #include "memory.h"
 
 // own
+#include "checkpoint.h"
 #include "../kpat_debug.h"
 // Std
 #include <cstdlib>
 #include <cstring>
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
 
 
 #define BLOCKSIZE (32 * 4096)
+#define LARGE_BLOCKSIZE (2 * 1024 * 1024)      /* one huge page on x86 */
+
+MemoryManager::MemoryManager()
+    : First(nullptr)
+    , Block(nullptr)
+    , Blocksize(BLOCKSIZE)
+    , Blocks_charged(0)
+    , Blocks_total(0)
+    , Large_pages(false)
+    , Table(nullptr)
+    , Tablesize(0)
+    , Tableused(0)
+    , Probe(0)
+    , Account(this)
+    , Mem_budget(DEFAULT_BUDGET)
+    , Mem_used(0)
+    , Mem_peak(0)
+{
+}
 
-/* Add it to the binary tree for this cluster.  The piles are stored
-following the TREE structure. */
+MemoryManager::~MemoryManager()
+{
+	free_store();
+	free_blocks();
+	drop_blocks(First);
+}
 
-size_t MemoryManager::Mem_remain = 30 * 1000 * 1000;
+/* Fingerprint of a packed position and its cluster.  This only has to
+spread the bits well: equal fingerprints are still compared in full. */
 
-MemoryManager::inscode MemoryManager::insert_node(TREE *n, int d, TREE **tree, TREE **node)
+static inline quint64 mix64(quint64 h)
 {
-        int c;
-	quint8 *key, *tkey;
-	TREE *t;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
 
-	key = (quint8 *)n + sizeof(TREE);
-	n->depth = d;
-	n->left = n->right = nullptr;
-	*node = n;
-	t = *tree;
-	if (t == nullptr) {
-		*tree = n;
-		return NEW;
+quint64 MemoryManager::fingerprint(const quint8 *key, int len, quint32 cluster)
+{
+	quint64 h = mix64(cluster + 0x9e3779b97f4a7c15ULL);
+	quint64 k;
+
+	while (len >= 8) {
+		memcpy(&k, key, 8);
+		h = mix64(h ^ k);
+		key += 8;
+		len -= 8;
 	}
-	while (true) {
-		tkey = (quint8 *)t + sizeof(TREE);
-		c = memcmp(key, tkey, Pilebytes);
-		if (c == 0) {
-			break;
-		}
-		if (c < 0) {
-			if (t->left == nullptr) {
-				t->left = n;
-				return NEW;
-			}
-			t = t->left;
-		} else {
-			if (t->right == nullptr) {
-				t->right = n;
-				return NEW;
-			}
-			t = t->right;
-		}
+	if (len > 0) {
+		k = 0;
+		memcpy(&k, key, len);
+		h = mix64(h ^ k ^ ((quint64)len << 56));
 	}
 
-	/* We get here if it's already in the tree.  Don't add it again.
-	If the new path to this position was shorter, record the new depth
-	so we can prune the original path. */
-
-        return FOUND;
+	return h;
 }
 
-/* Given a cluster number, return a tree.  There are 14^4 possible
-clusters, but we'll only use a few hundred of them at most.  Hash on
-the cluster number, then locate its tree, creating it if necessary. */
+/* Look for a position in the position table.  fp must be the fingerprint
+of the whole position, and same(ctx, node) tells whether node is the
+position looked for; it is only asked about nodes whose fingerprint and
+cluster match, so the nodes of most other positions are never touched.
+The table uses open addressing with linear probing; slots with a null node
+are empty.  If the position is not there, add_node() may store it in the
+slot the probe ended at. */
 
-#define TBUCKETS 499    /* a prime */
+MemoryManager::inscode MemoryManager::find_node(quint64 fp, unsigned int cluster, TREE **node,
+						samefunc same, void *ctx)
+{
+	size_t mask, i;
+	POSSLOT *slot;
+
+	mask = Tablesize - 1;
+	for (i = fp & mask; Table[i].node; i = (i + 1) & mask) {
+		slot = &Table[i];
+		if (slot->fp == fp && slot->node->cluster == cluster &&
+		    same(ctx, slot->node)) {
+			*node = slot->node;
+			return FOUND;
+		}
+	}
+	Probe = i;
 
-TREELIST *Treelist[TBUCKETS];
+	return NEW;
+}
 
-/* Clusters are also stored in a hashed array. */
+/* Store the position find_node() didn't find.  Nothing may be added to
+the table in between. */
 
-void MemoryManager::init_clusters(void)
+MemoryManager::inscode MemoryManager::add_node(TREE *n, quint64 fp, unsigned int cluster, int d)
 {
-	memset(Treelist, 0, sizeof(Treelist));
-	Block = new_block();                    /* @@@ */
-}
+	Q_ASSERT(Table[Probe].node == nullptr);
 
-TREELIST *MemoryManager::cluster_tree(unsigned int cluster)
-{
-	int bucket;
-	TREELIST *tl, *last;
+	n->cluster = cluster;
+	n->depth = d;
+	Table[Probe].fp = fp;
+	Table[Probe].node = n;
+
+	/* Keep the load factor below 3/4 so probe sequences stay short.  If
+	there is no memory left to grow the table, keep filling it up (the
+	positions themselves need memory too, so we will run out of that
+	soon anyway), but always leave some empty slots to end the probes. */
+
+	++Tableused;
+	if (Tableused * 4 > Tablesize * 3 && !grow_table() &&
+	    Tableused * 64 > Tablesize * 63) {
+		return ERR;
+	}
+
+	return NEW;
+}
 
-	/* Pick a bucket, any bucket. */
+/* Double the size of the position table.  The stored fingerprints
+are enough to find the new slots, the positions themselves are not
+looked at. */
 
-	bucket = cluster % TBUCKETS;
+bool MemoryManager::grow_table(void)
+{
+	POSSLOT *old = Table;
+	size_t oldsize = Tablesize;
+	size_t mask, i, j;
 
-	/* Find the tree in this bucket with that cluster number. */
+	POSSLOT *t = new_array<POSSLOT>(oldsize * 2);
+	if (t == nullptr) {
+		return false;
+	}
+	Table = t;
+	Tablesize = oldsize * 2;
+	mask = Tablesize - 1;
 
-	last = nullptr;
-	for (tl = Treelist[bucket]; tl; tl = tl->next) {
-		if (tl->cluster == cluster) {
-			break;
+	for (i = 0; i < oldsize; ++i) {
+		if (old[i].node) {
+			for (j = old[i].fp & mask; Table[j].node; j = (j + 1) & mask) {
+			}
+			Table[j] = old[i];
 		}
-		last = tl;
 	}
+	free_array(old, oldsize);
 
-	/* If we didn't find it, make a new one and add it to the list. */
+	return true;
+}
 
-	if (tl == nullptr) {
-		tl = mm_allocate<TREELIST>();
-		if (tl == nullptr) {
-			return nullptr;
-		}
-		tl->tree = nullptr;
-		tl->cluster = cluster;
-		tl->next = nullptr;
-		if (last == nullptr) {
-			Treelist[bucket] = tl;
-		} else {
-			last->next = tl;
-		}
+bool MemoryManager::init_store(void)
+{
+	Tablesize = MIN_SLOTS;
+	Tableused = 0;
+	Table = new_array<POSSLOT>(Tablesize);
+
+	/* Start over at the first block, if the last search left one. */
+
+	if (First == nullptr) {
+		First = new_block(Blocksize);
+	} else if (charge(First->size)) {
+		Blocks_charged += First->size;
+		First->ptr = First->block;
+		First->remain = First->size;
+	} else {
+		return false;
 	}
-
-	return tl;
+	Block = First;
+	return Table != nullptr && Block != nullptr;
 }
 
-/* Block storage.  Reduces overhead, and can be freed quickly. */
+/* Block storage.  Reduces overhead, and can be freed quickly.  The memory
+of a block is not cleared; everything stored in it is written in full. */
 
-BLOCK *MemoryManager::new_block(void)
+BLOCK *MemoryManager::new_block(size_t size)
 {
 	BLOCK *b;
+	void *p = nullptr;
 
-	b = mm_allocate<BLOCK>();
-	if (b == nullptr) {
+	if (!charge(size)) {
 		return nullptr;
 	}
-	b->block = mm_new_array<quint8>(BLOCKSIZE);
-	if (b->block == nullptr) {
-                MemoryManager::free_ptr(b);
+	b = (BLOCK *)malloc(sizeof(BLOCK));
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+	if (Large_pages) {
+		if (posix_memalign(&p, Blocksize, size) == 0) {
+			madvise(p, size, MADV_HUGEPAGE);
+		} else {
+			p = nullptr;
+		}
+	} else
+#endif
+	p = malloc(size);
+	if (b == nullptr || p == nullptr) {
+		free(b);
+		free(p);
+		release(size);
 		return nullptr;
 	}
+	Blocks_charged += size;
+	Blocks_total += size;
+	b->block = (quint8 *)p;
 	b->ptr = b->block;
-	b->remain = BLOCKSIZE;
+	b->remain = size;
+	b->size = size;
 	b->next = nullptr;
 
 	return b;
 }
 
-/* Like new(), only from the current block.  Make a new block if necessary. */
+/* Like new(), only from the current block.  Move on to the next block,
+which is either left over from an earlier search or a new one. */
 
 quint8 *MemoryManager::new_from_block(size_t s)
 {
@@ -161,11 +244,21 @@ quint8 *MemoryManager::new_from_block(size_t s)
 
 	b = Block;
 	if (s > b->remain) {
-		b = new_block();
+		b = b->next;
 		if (b == nullptr) {
-			return nullptr;
+			b = new_block(Blocksize);
+			if (b == nullptr) {
+				return nullptr;
+			}
+			Block->next = b;
+		} else {
+			if (!charge(b->size)) {
+				return nullptr;
+			}
+			Blocks_charged += b->size;
+			b->ptr = b->block;
+			b->remain = b->size;
 		}
-		b->next = Block;
 		Block = b;
 	}
 
@@ -176,9 +269,9 @@ quint8 *MemoryManager::new_from_block(size_t s)
 	return p;
 }
 
-/* Return the previous result of new_from_block() to the block.  This
-can ONLY be called once, immediately after the call to new_from_block().
-That is, no other calls to new_from_block() are allowed. */
+/* Return the previous result of new_from_block() to the block, from p
+on; p may also point into it, to give back only the unused end.  No
+other calls to new_from_block() are allowed in between. */
 
 void MemoryManager::give_back_block(quint8 *p)
 {
@@ -191,32 +284,168 @@ void MemoryManager::give_back_block(quint8 *p)
 	b->remain += s;
 }
 
+/* Forget everything stored in the blocks.  The blocks themselves are
+kept for the next search, so this does not touch them, unless there are
+more than we want to keep around between searches.  With large pages
+(batch solving) all of them are kept. */
+
 void MemoryManager::free_blocks(void)
 {
-	BLOCK *b, *next;
+	BLOCK *b;
+	size_t kept;
 
-	b = Block;
+	release(Blocks_charged);
+	Blocks_charged = 0;
+	Block = nullptr;
+
+	if (Large_pages || Blocks_total <= KEEP_BYTES) {
+		return;
+	}
+	kept = 0;
+	for (b = First; b->next && kept + b->size < KEEP_BYTES; b = b->next) {
+		kept += b->size;
+	}
+	drop_blocks(b->next);
+	b->next = nullptr;
+}
+
+/* Free the blocks from b on.  None of them may be in use. */
+
+void MemoryManager::drop_blocks(BLOCK *b)
+{
+	BLOCK *next;
+
+	if (b == First) {
+		First = nullptr;
+	}
 	while (b) {
 		next = b->next;
-                MemoryManager::free_array(b->block, BLOCKSIZE);
-                MemoryManager::free_ptr(b);
+		Blocks_total -= b->size;
+		free(b->block);
+		free(b);
 		b = next;
 	}
 }
 
-void MemoryManager::free_clusters(void)
+/* Use huge pages for the blocks where the system has them.  That saves
+TLB misses in long searches, but the blocks get much bigger.  Call this
+only between searches. */
+
+void MemoryManager::set_large_pages(bool on)
+{
+	Q_ASSERT(Blocks_charged == 0);
+	if (on == Large_pages) {
+		return;
+	}
+	drop_blocks(First);
+	Large_pages = on;
+	Blocksize = on ? LARGE_BLOCKSIZE : BLOCKSIZE;
+}
+
+void MemoryManager::free_store(void)
+{
+	if (Table) {
+		free_array(Table, Tablesize);
+	}
+	Table = nullptr;
+	Tablesize = Tableused = 0;
+}
+
+/* Call f for every position in the table. */
+
+void MemoryManager::for_each_node(nodefunc f, void *ctx)
+{
+	for (size_t i = 0; i < Tablesize; ++i) {
+		if (Table[i].node) {
+			f(ctx, Table[i].node);
+		}
+	}
+}
+
+/* Write the blocks in use, as far as they are filled, and the position
+table.  The pointers in there are saved as they are; restore() tells
+where the blocks went. */
+
+void MemoryManager::save(CheckpointWriter &out) const
+{
+	quint32 n = 0;
+	BLOCK *b;
+
+	for (b = First; b; b = b->next) {
+		++n;
+		if (b == Block) {
+			break;
+		}
+	}
+	out << n;
+	for (b = First; n-- > 0; b = b->next) {
+		out << quint64(quintptr(b->block)) << quint64(b->ptr - b->block);
+		out.raw(b->block, b->ptr - b->block);
+	}
+	out << quint64(Tablesize) << quint64(Tableused);
+	out.raw(Table, Tablesize * sizeof(POSSLOT));
+}
+
+/* Read back what save() wrote.  Every saved block is copied as a whole,
+as positions may not be split between blocks.  One bigger than ours,
+saved with large pages, gets a block of its own, as big as it. */
+
+bool MemoryManager::restore(CheckpointReader &in, Relocation *moved)
 {
-	int i;
-	TREELIST *l, *n;
+	quint32 n = 0;
+	quint64 from = 0, used = 0, size = 0, tableused = 0;
+	quint8 *to;
+
+	in >> n;
+	while (n-- > 0 && in.ok()) {
+		in >> from >> used;
+		if (!in.ok() || used == 0) {
+			continue;
+		}
+		if ((used & 7) != 0) {
+			return false;
+		}
+		if (used > Blocksize) {
+			BLOCK *b = new_block(used);
+			if (b == nullptr) {
+				return false;
+			}
+			b->ptr += used;
+			b->remain = 0;
+			b->next = Block->next;
+			Block->next = b;
+			Block = b;
+			to = b->block;
+		} else if ((to = new_from_block(used)) == nullptr) {
+			return false;
+		}
+		if (!in.raw(to, used)) {
+			return false;
+		}
+		moved->add(from, used, to);
+	}
+	moved->finish();
 
-	for (i = 0; i < TBUCKETS; i++) {
-		l = Treelist[i];
-		while (l) {
-			n = l->next;
-                        MemoryManager::free_ptr(l);
-			l = n;
+	in >> size >> tableused;
+	if (!in.ok() || size < MIN_SLOTS || (size & (size - 1)) != 0 || tableused >= size) {
+		return false;
+	}
+	free_store();
+	Table = new_array<POSSLOT>(size);
+	if (Table == nullptr) {
+		return false;
+	}
+	Tablesize = size;
+	Tableused = tableused;
+	if (!in.raw(Table, size * sizeof(POSSLOT))) {
+		return false;
+	}
+	for (size_t i = 0; i < Tablesize; ++i) {
+		if (Table[i].node) {
+			Table[i].node = moved->at(Table[i].node);
 		}
 	}
+	return moved->ok();
 }
 
 /* Allocate some space and return a pointer to it.  See new() in util.h. */
@@ -225,15 +454,47 @@ void *MemoryManager::allocate_memory(size_t s)
 {
 	void *x;
 
-	if (s > Mem_remain) {
+	if (!charge(s)) {
 		return nullptr;
 	}
 
 	// use calloc to ensure that the memory is zeroed
 	if ((x = calloc(1, s)) == nullptr) {
+		release(s);
 		return nullptr;
 	}
 
-	Mem_remain -= s;
 	return x;
 }
+
+/* Account for s more bytes, unless that would go over the budget.  The
+budget may be shared with the solvers on other threads. */
+
+bool MemoryManager::charge(size_t s)
+{
+	MemoryManager *a = Account;
+	size_t used = a->Mem_used;
+	size_t budget = a->Mem_budget;
+	size_t peak;
+
+	do {
+		if (s > budget || used > budget - s) {
+			return false;
+		}
+	} while (!a->Mem_used.compare_exchange_weak(used, used + s));
+
+	used += s;
+	peak = a->Mem_peak;
+	while (used > peak && !a->Mem_peak.compare_exchange_weak(peak, used)) {
+	}
+	return true;
+}
+
+/* Charge everything to the budget of with from now on, or to our own one
+again if with is null.  Only while nothing is allocated. */
+
+void MemoryManager::share_budget(MemoryManager *with)
+{
+	Q_ASSERT(Blocks_charged == 0 && Table == nullptr);
+	Account = with ? with : this;
+}
@@ -19,86 +19,146 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+// Qt
+#include <QtGlobal>
 // Std
+#include <atomic>
 #include <cstdlib>
 #include <sys/types.h>
 
 struct TREE;
+class CheckpointReader;
+class CheckpointWriter;
+class Relocation;
 
-/* Memory. */
+/* Memory.  Positions and piles are carved out of a chain of blocks that
+the solver keeps from one search to the next. */
 
 struct BLOCK;
 struct BLOCK {
 	unsigned char *block;
 	unsigned char *ptr;
 	size_t remain;
+	size_t size;
         BLOCK *next;
 };
 
-struct TREELIST;
-struct TREELIST {
-	TREE *tree;
-	unsigned int cluster;
-	TREELIST *next;
-};
-
 /* Position information.  We store a compact representation of the position;
 Temp cells are stored separately since they don't have to be compared.
 We also store the move that led to this position from the parent, as well
-as a pointers back to the parent, and the btree of all positions examined so
-far. */
+as a pointers back to the parent.  The TREE header is followed by the packed
+pile ids, keylen bytes of them; all positions examined so far are found
+through the hash table in the MemoryManager. */
 struct TREE {
-	TREE *left;
-	TREE *right;
+	quint32 cluster;
 	short depth;
+	quint16 keylen;
+};
+
+/* A slot of the position table.  The fingerprint is kept next to the
+pointer so that most probes never have to touch the stored position. */
+struct POSSLOT {
+	quint64 fp;
+	TREE *node;
 };
 
+/* Curses and some platform headers define ERR, which would clash with
+MemoryManager::ERR; it is undefined here, next to the enum, so that the
+files using it need not each do so. */
 #ifdef ERR
 #undef ERR
 #endif
 
+/* Every solver owns its own MemoryManager, so nothing in here may be
+shared between instances; several solvers can then run concurrently.
+Only the solver's thread allocates, but the budget may be changed and
+the usage read from other threads, hence the atomics.  The solvers of a
+parallel search charge all their memory to the budget of one of them,
+see share_budget(). */
+
 class MemoryManager
 {
 public:
     enum inscode { NEW, FOUND, ERR };
 
+    MemoryManager();
+    ~MemoryManager();
+
     unsigned char *new_from_block(size_t s);
-    void init_clusters(void);
+    bool init_store(void);
     void free_blocks(void);
-    void free_clusters(void);
-    TREELIST *cluster_tree(unsigned int cluster);
-    inscode insert_node(TREE *n, int d, TREE **tree, TREE **node);
+    void free_store(void);
+    typedef bool (*samefunc)(void *ctx, const TREE *node);
+    static quint64 fingerprint(const quint8 *key, int len, quint32 cluster);
+    inscode find_node(quint64 fp, unsigned int cluster, TREE **node, samefunc same, void *ctx);
+    inscode add_node(TREE *n, quint64 fp, unsigned int cluster, int d);
     void give_back_block(unsigned char *p);
+    typedef void (*nodefunc)(void *ctx, TREE *node);
+    void for_each_node(nodefunc f, void *ctx);
+
+    /* The stored positions and the position table, for checkpoints;
+    see Solver::saveCheckpoint().  restore() goes after init_store(). */
+    void save(CheckpointWriter &out) const;
+    bool restore(CheckpointReader &in, Relocation *moved);
 
-    BLOCK *new_block(void);
+    BLOCK *new_block(size_t size);
+    void set_large_pages(bool on);
 
     template<class T>
-    static void free_ptr(T *ptr) {
-        free(ptr); Mem_remain += sizeof(T);
+    void free_ptr(T *ptr) {
+        free(ptr); release(sizeof(T));
     }
 
     template<class T>
-    static void free_array(T *ptr, size_t size) {
+    void free_array(T *ptr, size_t size) {
         free(ptr);
-        Mem_remain += size * sizeof(T);
+        release(size * sizeof(T));
     }
 
-    static void *allocate_memory(size_t s);
+    template<typename T>
+    T* new_array(const size_t size) {
+        return static_cast<T*>(allocate_memory(size * sizeof(T)));
+    }
 
-    // ugly hack
-    int Pilebytes;
-    static size_t Mem_remain;
-private:
-    BLOCK *Block;
+    template<typename T>
+    T* allocate() {return static_cast<T*>(allocate_memory(sizeof(T)));}
 
-};
+    void *allocate_memory(size_t s);
 
-template<typename T>
-T* mm_new_array(const size_t size) {
-    return static_cast<T*>(MemoryManager::allocate_memory(size * sizeof(T)));
-}
+    void set_budget(size_t bytes) { Mem_budget = bytes; }
+    size_t budget() const { return Account->Mem_budget; }
+    size_t used() const { return Account->Mem_used; }
+    size_t peak() const { return Account->Mem_peak; }
+    void reset_peak() { Account->Mem_peak = Account->Mem_used.load(); }
+    void share_budget(MemoryManager *with);
 
-template<typename T>
-T* mm_allocate() {return static_cast<T*>(MemoryManager::allocate_memory(sizeof(T)));}
+    static constexpr size_t DEFAULT_BUDGET = 30 * 1000 * 1000;
+
+private:
+    bool grow_table(void);
+    bool charge(size_t s);
+    void release(size_t s) { Account->Mem_used -= s; }
+    void drop_blocks(BLOCK *b);
+
+    static constexpr size_t MIN_SLOTS = 4096;   /* a power of two */
+    static constexpr size_t KEEP_BYTES = 4 * 1024 * 1024;
+
+    BLOCK *First;               /* the oldest block, where a search starts */
+    BLOCK *Block;               /* the block being filled */
+    size_t Blocksize;
+    size_t Blocks_charged;      /* bytes of the blocks the current search uses */
+    size_t Blocks_total;        /* bytes of all the blocks we have */
+    bool Large_pages;
+    POSSLOT *Table;
+    size_t Tablesize;           /* number of slots, a power of two */
+    size_t Tableused;
+    size_t Probe;               /* the empty slot find_node() ended at */
+
+    MemoryManager *Account;     /* whose budget we use, normally this */
+
+    std::atomic<size_t> Mem_budget;
+    std::atomic<size_t> Mem_used;
+    std::atomic<size_t> Mem_peak;
+};
 
 #endif // MEMORY_H
@@ -119,14 +119,8 @@ void Mod3Solver::undo_move(MOVE *m)
         int len = m->card_index;
         if ( len > 8 )
             len = 8;
-        for ( int i = len; i >= 0; i-- )
+        for ( int i = len - 1; i >= 0; i-- )
         {
-            if (Wlen[i] == 0) {
-                // there exists no card to move
-                /* TODO: determine if we need to call hashpile here
-                / or do any other work */
-                continue;
-            }
             card_t card = *Wp[24+i];
             Wlen[deck]++;
             Wp[deck]++;
@@ -346,12 +340,26 @@ int Mod3Solver::getOuts()
     return ret;
 }
 
+/* The cluster counts the aces that went out.  The cards built on the
+foundation rows are left out: every one of them would make solve() go
+depth first, and that loses far more deals than it wins. */
+
+unsigned int Mod3Solver::getClusterNumber()
+{
+    return Wlen[aces];
+}
+
 Mod3Solver::Mod3Solver(const Mod3 *dealer)
     : Solver()
 {
     deal = dealer;
 }
 
+Mod3Solver *Mod3Solver::clone() const
+{
+    return new Mod3Solver( *this );
+}
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
 card).  Temp cells and Out on the last two lines, if any. */
 
@@ -27,11 +27,13 @@ class Mod3Solver : public Solver</* 24 targets, 8 playing fields, deck, aces =*/
 {
 public:
     explicit Mod3Solver(const Mod3 *dealer);
+    Mod3Solver *clone() const override;
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
     void make_move(MOVE *m) override;
     void undo_move(MOVE *m) override;
     int getOuts() override;
+    unsigned int getClusterNumber() override;
     void translate_layout() override;
     MoveHint translateMove(const MOVE &m) override;
 
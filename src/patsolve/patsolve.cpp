@@ -19,9 +19,17 @@
 #include "patsolve.h"
 
 // own
+#include "checkpoint.h"
+#include "sharedsearch.h"
+#include "spillset.h"
 #include "../patpile.h"
 #include "../kpat_debug.h"
+// Qt
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtAlgorithms>
 // Std
+#include <algorithm>
 #include <cctype>
 #include <cmath>
 #include <cstdarg>
@@ -35,40 +43,99 @@
 #undef ERR
 #endif
 
-long all_moves = 0;
-
-/* This is a 32 bit FNV hash.  For more information, see
-http://www.isthe.com/chongo/tech/comp/fnv/index.html */
+std::atomic<long> all_moves(0);
 
+/* Piles are hashed Zobrist style: the hash of a pile is the XOR of one
+random key for every card, and the key depends on the card and its height
+in the pile.  Pushing or popping a card is then a single XOR. */
 
 namespace {
-constexpr qint32 FNV_32_PRIME = 0x01000193; // FIXME: move into fnv_hash once we depend on C++14
-constexpr qint32 fnv_hash(qint32 x, qint32 hash) {return (hash * FNV_32_PRIME) ^ x;}
-/* Hash a 0 terminated string. */
-
-quint32 fnv_hash_str(const quint8 *s)
-{
-        constexpr qint32 FNV1_32_INIT = 0x811C9DC5;
-	quint32 h;
-
-	h = FNV1_32_INIT;
-	while (*s) {
-		h = fnv_hash(*s++, h);
+constexpr int MAXPILE = 84;         /* the size of the work piles */
+
+/* A card only uses 7 bits: rank, suit and the face down bit. */
+constexpr int cardkey(card_t card) {return (card & 0x3f) | ((card >> 1) & 0x40);}
+
+const std::array<quint32, MAXPILE * 128> Zobrist = [] {
+	std::array<quint32, MAXPILE * 128> keys;
+	quint64 x = 0x9e3779b97f4a7c15ULL;
+	for (auto& key: keys) {
+		/* splitmix64 */
+		quint64 z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		key = quint32((z ^ (z >> 31)) >> 32);
 	}
+	return keys;
+}();
 
-	return h;
+inline quint32 zobrist(int i, card_t card)
+{
+	return Zobrist[i * 128 + cardkey(card)];
 }
 }
 
 
 
-/* Hash a pile. */
+/* Hash a pile.  The game solvers only push cards onto or pop cards off the
+top of a pile (possibly turning the new top card over) before calling us,
+so only the cards from the top of the shorter of the old and the new pile
+on have to be looked at.  Wshadow holds the cards the hash was built from,
+as the popped cards may have been overwritten already. */
 
 template<size_t NumberPiles>
 void Solver<NumberPiles>::hashpile(int w)
 {
-   	W[w][Wlen[w]] = 0;
-	Whash[w] = fnv_hash_str(W[w]);
+	rehashpile(w, Wlen[w]);
+}
+
+/* Hash a pile again after card i was changed in place, for the piles
+that are not used as stacks. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::rehashpile(int w, int i)
+{
+	int j, start, common;
+	card_t *shadow = Wshadow[w].data();
+	quint32 h = Whash[w];
+
+	/* Cards below the common part may have been turned over. */
+
+	common = qMin(Whashlen[w], Wlen[w]);
+	start = qMin(i, common - 1);
+	if (start < 0) {
+		start = 0;
+	}
+	for (j = start; j < common; ++j) {
+		if (shadow[j] != W[w][j]) {
+			h ^= zobrist(j, shadow[j]) ^ zobrist(j, W[w][j]);
+			shadow[j] = W[w][j];
+		}
+	}
+
+	/* Then the popped and the pushed cards. */
+
+	for (j = common; j < Whashlen[w]; ++j) {
+		h ^= zobrist(j, shadow[j]);
+	}
+	for (j = common; j < Wlen[w]; ++j) {
+		h ^= zobrist(j, W[w][j]);
+		shadow[j] = W[w][j];
+	}
+	Whash[w] = h;
+	Whashlen[w] = Wlen[w];
+
+	/* Builds with HASHPILE_DEBUG, such as the solver tests, check every
+	hash against one made from scratch, in release builds too. */
+
+#ifdef HASHPILE_DEBUG
+	h = 0;
+	for (j = 0; j < Wlen[w]; ++j) {
+		h ^= zobrist(j, W[w][j]);
+	}
+	if (Whash[w] != h) {
+		qFatal("hash of pile %d out of step with its cards", w);
+	}
+#endif
 
 	/* Invalidate this pile's id.  We'll calculate it later. */
 
@@ -124,7 +191,7 @@ MOVE *Solver<NumberPiles>::get_moves(int *nmoves)
 	do the recursive solve() on them, but only after queueing the other
 	moves. */
 
-	mp = mp0 = mm_new_array<MOVE>(n);
+	mp = mp0 = mm->new_array<MOVE>(n);
 	if (mp == nullptr) {
 		return nullptr;
 	}
@@ -158,8 +225,6 @@ MOVE *Solver<NumberPiles>::get_moves(int *nmoves)
 /* Test the current position to see if it's new (or better).  If it is, save
 it, along with the pointer to its parent and the move we used to get here. */
 
-int Posbytes;
-
 template<size_t NumberPiles>
 void Solver<NumberPiles>::pilesort(void)
 {
@@ -177,85 +242,287 @@ void Solver<NumberPiles>::pilesort(void)
         //fprintf( stderr, "\n" );
 }
 
-#define NBUCKETS 65521           /* the largest 16 bit prime */
-#define NPILES   65536           /* a 16 bit code */
+/* Nodes in block storage are kept 8 byte aligned. */
 
-typedef struct bucketlist {
-	quint8 *pile;           /* 0 terminated copy of the pile */
-	quint32 hash;         /* the pile's hash code */
-	int pilenum;            /* the unique id for this pile */
-	struct bucketlist *next;
-} BUCKETLIST;
+#define ALIGN_BITS 0x7
+
+/* Pile ids are stored with the most significant byte first, and the
+top bits of the first byte give the length:
+	0xxxxxxx xxxxxxxx                       ids below 2^15
+	10xxxxxx xxxxxxxx xxxxxxxx              ids below 2^22
+	11xxxxxx xxxxxxxx xxxxxxxx xxxxxxxx     ids below 2^30
+Each id has only one encoding.  Most searches never get past 2 bytes, but
+the long ones are not limited by the number of ids any more. */
+
+static inline quint8 *put_pileid(quint8 *p, quint32 id)
+{
+	if (id < 0x8000) {
+		p[0] = id >> 8;
+		p[1] = id;
+		return p + 2;
+	}
+	if (id < 0x400000) {
+		p[0] = 0x80 | (id >> 16);
+		p[1] = id >> 8;
+		p[2] = id;
+		return p + 3;
+	}
+	p[0] = 0xc0 | (id >> 24);
+	p[1] = id >> 16;
+	p[2] = id >> 8;
+	p[3] = id;
+	return p + 4;
+}
 
-BUCKETLIST *Bucketlist[NBUCKETS];
-int Pilenum;                    /* the next pile number to be assigned */
+static inline int pileid_size(quint32 id)
+{
+	return id < 0x8000 ? 2 : id < 0x400000 ? 3 : 4;
+}
 
-BUCKETLIST *Pilebucket[NPILES]; /* reverse lookup for unpack to get the bucket
-				   from the pile */
+static inline const quint8 *get_pileid(const quint8 *p, quint32 *id)
+{
+	if (p[0] < 0x80) {
+		*id = (p[0] << 8) | p[1];
+		return p + 2;
+	}
+	if (p[0] < 0xc0) {
+		*id = ((p[0] & 0x3f) << 16) | (p[1] << 8) | p[2];
+		return p + 3;
+	}
+	*id = (quint32(p[0] & 0x3f) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	return p + 4;
+}
 
 /* Compact position representation.  The position is stored as an
 array with the following format:
 	pile0# pile1# ... pileN# (N = Nwpiles)
-where each pile number is packed into 16 bits (so a pile take 2 bytes).
-Positions in this format are unique can be compared with memcmp().  The O
+where each pile number is packed as above, in 2 to 4 bytes.  Positions
+in this format are unique can be compared with memcmp().  The O
 cells are encoded as a cluster number: no two positions with different
-cluster numbers can ever be the same, so we store different clusters in
-different trees.  */
+cluster numbers can ever be the same, so the cluster is stored in the TREE
+header and is part of the position's fingerprint.
 
-int Treebytes;
+With compact positions, only every KEYFRAME_DEPTH'th level of the search
+stores full keys like that.  Other nodes store a pointer to their parent's
+node and the piles that differ from it, see pack_delta(). */
 
 template<size_t NumberPiles>
-TREE *Solver<NumberPiles>::pack_position(void)
+TREE *Solver<NumberPiles>::pack_position(TREE *parent, int depth)
 {
-	int j;
+	int size;
 	quint8 *p;
 	TREE *node;
 
-	/* Allocate space and store the pile numbers.  The tree node
-	will get filled in later, by insert_node(). */
+	/* insert() already packed the full key into Keybuf. */
+
+	if (Compact && parent != nullptr && depth % KEYFRAME_DEPTH != 0 &&
+	    pack_delta(parent, &node)) {
+		return node;
+	}
+
+	/* The rest of the TREE header will get filled in later, by
+	add_node(). */
 
-	p = mm->new_from_block(Treebytes);
+	size = (sizeof(TREE) + Keylen + ALIGN_BITS) & ~ALIGN_BITS;
+	p = mm->new_from_block(size);
 	if (p == nullptr) {
-                Status = UnableToDetermineSolvability;
+		Status = UnableToDetermineSolvability;
 		return nullptr;
 	}
 	node = (TREE *)p;
-	p += sizeof(TREE);
+	node->keylen = Keylen;
+	memcpy(p + sizeof(TREE), Keybuf.data(), Keylen);
+	return node;
+}
+
+/* Pack the pile numbers into Keybuf. */
 
-	/* Pack the pile numers j into bytes p.
-		       j             j
-		+--------+----:----+--------+
-		|76543210|7654:3210|76543210|
-		+--------+----:----+--------+
-		    p         p         p
-	*/
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::pack_key()
+{
+	quint8 *p = Keybuf.data();
 
-        quint16 *p2 = ( quint16* ) p;
 	for (size_t w = 0; w < NumberPiles; ++w) {
-		j = Wpilenum[w];
-                if ( j < 0 )
-                {
-                    mm->give_back_block( p );
-                    return nullptr;
-                }
-                *p2++ = j;
+		if (Wpilenum[w] < 0) {
+			return false;
+		}
+		p = put_pileid(p, Wpilenum[w]);
 	}
+	Keylen = p - Keybuf.data();
+	return true;
+}
 
-	return node;
+/* Put the entries of v that belong to piles of the same class in order,
+class by class; see pile_classes().  There are few piles, so a few
+comparisons too many don't matter.  Return whether anything moved. */
+
+template<class T>
+static bool sort_classes(T *v, const quint8 *classes, size_t n)
+{
+	bool moved = false;
+
+	for (size_t w = 1; w < n; ++w) {
+		if (classes[w] == 0) {
+			continue;
+		}
+		for (size_t u = 0; u < w; ++u) {
+			if (classes[u] == classes[w] && v[w] < v[u]) {
+				std::swap(v[u], v[w]);
+				moved = true;
+			}
+		}
+	}
+	return moved;
 }
 
-/* Like strcpy() but return the length of the string. */
+/* The fingerprint of the position in Keybuf.  If some of its piles are
+interchangeable, it is the fingerprint of the key with them in order,
+so all the ways of placing them give the same one; same_position() then
+compares them in order too.  The stored key keeps the piles where they
+are, which is what the moves that lead to the position and from it refer
+to. */
 
-static inline int strecpy(unsigned char *d, unsigned char *s)
+template<size_t NumberPiles>
+quint64 Solver<NumberPiles>::key_fingerprint(quint32 cluster)
 {
-	int i;
+	quint8 key[NumberPiles * 4];
+	quint8 *p = key;
 
-	i = 0;
-	while ((*d++ = *s++) != '\0') {
-		i++;
+	Classes = Symmetry ? pile_classes() : nullptr;
+	if (Classes) {
+		Canonids = Wpilenum;
+	}
+	if (Classes == nullptr || !sort_classes(Canonids.data(), Classes, NumberPiles)) {
+		return MemoryManager::fingerprint(Keybuf.data(), Keylen, cluster);
+	}
+	for (size_t w = 0; w < NumberPiles; ++w) {
+		p = put_pileid(p, Canonids[w]);
+	}
+	return MemoryManager::fingerprint(key, p - key, cluster);
+}
+
+/* Store the position in Wpilenum as the piles that differ from the ones
+of parent:
+	parent-node count pile# id# pile# id# ...
+Return false, without storing anything, if a full key takes no more room. */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::pack_delta(TREE *parent, TREE **node)
+{
+	int size, count = 0;
+	quint8 *p;
+
+	cache_pilenums(parent);
+	size = sizeof(TREE) + sizeof(TREE *) + 1;
+	for (size_t w = 0; w < NumberPiles; ++w) {
+		if (Wpilenum[w] != Cacheids[w]) {
+			size += 1 + pileid_size(Wpilenum[w]);
+			count++;
+		}
+	}
+	size = (size + ALIGN_BITS) & ~ALIGN_BITS;
+	if (size >= (int)((sizeof(TREE) + Keylen + ALIGN_BITS) & ~ALIGN_BITS)) {
+		return false;
+	}
+
+	p = mm->new_from_block(size);
+	if (p == nullptr) {
+		Status = UnableToDetermineSolvability;
+		*node = nullptr;
+		return true;
+	}
+	*node = (TREE *)p;
+	(*node)->keylen = DELTA_KEY;
+	p += sizeof(TREE);
+	memcpy(p, &parent, sizeof(TREE *));
+	p += sizeof(TREE *);
+	*p++ = count;
+	for (size_t w = 0; w < NumberPiles; ++w) {
+		if (Wpilenum[w] != Cacheids[w]) {
+			*p++ = w;
+			p = put_pileid(p, Wpilenum[w]);
+		}
+	}
+	return true;
+}
+
+/* Get the pile numbers of a stored position.  A delta node is rebuilt from
+the nearest full key above it, or from the cached node if that's closer. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::node_pilenums(const TREE *node, int *ids)
+{
+	const TREE *chain[KEYFRAME_DEPTH];
+	const quint8 *p;
+	quint32 id;
+	int n = 0, count;
+
+	while ((node->keylen & DELTA_KEY) && node != Cachenode) {
+		Q_ASSERT(n < KEYFRAME_DEPTH);
+		chain[n++] = node;
+		memcpy(&node, (const quint8 *)node + sizeof(TREE), sizeof(TREE *));
+	}
+
+	if (node == Cachenode) {
+		if (ids != Cacheids.data()) {
+			memcpy(ids, Cacheids.data(), sizeof(Cacheids));
+		}
+	} else {
+		p = (const quint8 *)node + sizeof(TREE);
+		for (size_t w = 0; w < NumberPiles; ++w) {
+			p = get_pileid(p, &id);
+			ids[w] = id;
+		}
+	}
+
+	while (n > 0) {
+		p = (const quint8 *)chain[--n] + sizeof(TREE) + sizeof(TREE *);
+		count = *p++;
+		while (count-- > 0) {
+			int w = *p++;
+			p = get_pileid(p, &id);
+			ids[w] = id;
+		}
 	}
+}
+
+/* Remember the pile numbers of node; all the children of a position are
+packed against the same parent. */
 
-	return i;
+template<size_t NumberPiles>
+void Solver<NumberPiles>::cache_pilenums(const TREE *node)
+{
+	if (node != Cachenode) {
+		node_pilenums(node, Cacheids.data());
+		Cachenode = node;
+	}
+}
+
+/* Whether node is the position in Wpilenum, whose full key is in Keybuf,
+up to the order of interchangeable piles.  Called back by find_node(). */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::same_position(void *ctx, const TREE *node)
+{
+	Solver *s = static_cast<Solver *>(ctx);
+	int ids[NumberPiles];
+
+	s->Total_compared++;
+	if (!(node->keylen & DELTA_KEY)) {
+		if (node->keylen == s->Keylen &&
+		    memcmp((const quint8 *)node + sizeof(TREE), s->Keybuf.data(), s->Keylen) == 0) {
+			return true;
+		}
+		if (s->Classes == nullptr) {
+			return false;
+		}
+	}
+	s->node_pilenums(node, ids);
+	if (s->Classes) {
+		sort_classes(ids, s->Classes, NumberPiles);
+		return memcmp(ids, s->Canonids.data(), sizeof(ids)) == 0;
+	}
+	return memcmp(ids, s->Wpilenum.data(), sizeof(ids)) == 0;
 }
 
 /* Unpack a compact position rep.  T cells must be restored from the
@@ -265,30 +532,38 @@ template<size_t NumberPiles>
 void Solver<NumberPiles>::unpack_position(POSITION *pos)
 {
 	int i = 0;
-	BUCKETLIST *l;
+	PILE *l;
 
-        unpack_cluster(pos->cluster);
-
-	/* Unpack bytes p into pile numbers j.
-		    p         p         p
-		+--------+----:----+--------+
-		|76543210|7654:3210|76543210|
-		+--------+----:----+--------+
-		       j             j
-	*/
+	/* Unpack the key into pile numbers. */
 
 	size_t w = 0;
-	quint16 *p2 = ( quint16* )( (quint8 *)(pos->node) + sizeof(TREE) );
+	quint32 id;
+	const quint8 *p = nullptr;
+	const bool compact = Compact && !Spill;     /* see new_position() */
+	if (compact) {
+		cache_pilenums(pos->node);
+	} else {
+		p = (const quint8 *)(pos->node) + sizeof(TREE);
+	}
 	while (w < NumberPiles) {
-                i = *p2++;
-		Wpilenum[w] = i;
-		l = Pilebucket[i];
-		i = strecpy(W[w], l->pile);
+		if (compact) {
+			id = Cacheids[w];
+		} else {
+			p = get_pileid(p, &id);
+		}
+		Wpilenum[w] = id;
+		l = Piles[id];
+		i = l->len;
+		memcpy(W[w], pilecards(l), i);
+		memcpy(Wshadow[w].data(), W[w], i);
 		Wp[w] = &W[w][i - 1];
 		Wlen[w] = i;
 		Whash[w] = l->hash;
+		Whashlen[w] = i;
 		w++;
 	}
+
+	unpack_cluster(pos->cluster);
 }
 
 template<size_t NumberPiles>
@@ -327,7 +602,7 @@ void Solver<NumberPiles>::win(POSITION *pos)
 
     //printf("Winning in %d moves.\n", nmoves);
 
-    mpp0 = mm_new_array<MOVE *>(nmoves);
+    mpp0 = mm->new_array<MOVE *>(nmoves);
     if (mpp0 == nullptr) {
         Status = UnableToDetermineSolvability;
         return; /* how sad, so close... */
@@ -337,29 +612,30 @@ void Solver<NumberPiles>::win(POSITION *pos)
         *mpp-- = &p->move;
     }
 
+    m_winMoves = Prefix;
     for (i = 0, mpp = mpp0; i < nmoves; ++i, ++mpp)
         m_winMoves.append( **mpp );
 
-    MemoryManager::free_array(mpp0, nmoves);
+    mm->free_array(mpp0, nmoves);
 }
 
-/* Initialize the hash buckets. */
+/* Initialize the pile table. */
 
 template<size_t NumberPiles>
-void Solver<NumberPiles>::init_buckets(void)
+bool Solver<NumberPiles>::init_buckets(void)
 {
 	int i;
 
-	/* Packed positions need 3 bytes for every 2 piles. */
+	/* Packed positions need up to 4 bytes for every pile. */
 
-	i = ( NumberPiles ) * sizeof( quint16 );
-	i += ( NumberPiles ) & 0x1;
+	i = ( NumberPiles ) * 4;
 
-        mm->Pilebytes = i;
-
-	memset(Bucketlist, 0, sizeof(Bucketlist));
 	Pilenum = 0;
-	Treebytes = sizeof(TREE) + mm->Pilebytes;
+	Piletablesize = MIN_PILESLOTS;
+	Piletable = mm->new_array<PILESLOT>(Piletablesize);
+	Pilessize = MIN_PILESLOTS;
+	Piles = mm->new_array<PILE *>(Pilessize);
+	Treebytes = sizeof(TREE) + i;
 
 	/* In order to keep the TREE structure aligned, we need to add
 	up to 7 bytes on Alpha or 3 bytes on Intel -- but this is still
@@ -367,7 +643,6 @@ void Solver<NumberPiles>::init_buckets(void)
 	requires a pointer.  On Intel for -f Treebytes winds up being
 	a multiple of 8 currently anyway so it doesn't matter. */
 
-#define ALIGN_BITS 0x7
 	if (Treebytes & ALIGN_BITS) {
 		Treebytes |= ALIGN_BITS;
 		Treebytes++;
@@ -377,146 +652,804 @@ void Solver<NumberPiles>::init_buckets(void)
 		Posbytes |= ALIGN_BITS;
 		Posbytes++;
 	}
+
+	/* With a spilled visited set, positions carry their own key, so it
+	is recycled along with them.  There's room for the usual two bytes
+	per pile id; longer keys get a node of their own. */
+
+	Spillbytes = 0;
+	if (Spill) {
+		Spillbytes = (sizeof(TREE) + NumberPiles * 2 + ALIGN_BITS) & ~ALIGN_BITS;
+		Posbytes += Spillbytes;
+	}
+
+	return Piletable != nullptr && Piles != nullptr;
+}
+
+
+/* For each pile, return a unique identifier.  Although there are a
+large number of possible piles, generally fewer than 1000 different
+piles appear in any given game.  The piles are kept in an open addressing
+hash table (linear probing, power of two size) that stores the hash and
+the id of every pile; the cards themselves are stored once, in block
+storage, so a new pile costs no allocation of its own. */
+
+template<size_t NumberPiles>
+int Solver<NumberPiles>::get_pilenum(int w)
+{
+	quint32 hash = Whash[w];
+	quint32 mask = Piletablesize - 1;
+	quint32 i;
+	int pilenum, size;
+	PILE *l;
+
+	/* Look for the pile in the table.  Slots store the id plus one, so
+	that the zeroed table is empty. */
+
+	for (i = hash & mask; Piletable[i].id; i = (i + 1) & mask) {
+		if (Piletable[i].hash == hash) {
+			l = Piles[Piletable[i].id - 1];
+			if (l->len == Wlen[w] && memcmp(pilecards(l), W[w], Wlen[w]) == 0) {
+				return Piletable[i].id - 1;
+			}
+		}
+	}
+
+	/* If we didn't find it, store the new pile along with its hash in
+	the empty slot.  Maintain a reverse mapping so we can unpack the
+	piles swiftly. */
+
+	if (Pilenum >= MAXPILEID ) {
+                Status = UnableToDetermineSolvability;
+		//qCDebug(KPAT_LOG) << "out of piles";
+		return -1;
+	}
+	if (Pilenum == Pilessize) {
+		PILE **piles = mm->new_array<PILE *>(Pilessize * 2);
+		if (piles == nullptr) {
+                        Status = UnableToDetermineSolvability;
+			return -1;
+		}
+		memcpy(piles, Piles, Pilessize * sizeof(PILE *));
+		mm->free_array(Piles, Pilessize);
+		Piles = piles;
+		Pilessize *= 2;
+	}
+	size = (sizeof(PILE) + Wlen[w] + ALIGN_BITS) & ~ALIGN_BITS;
+	l = (PILE *)mm->new_from_block(size);
+	if (l == nullptr) {
+                Status = UnableToDetermineSolvability;
+		//qCDebug(KPAT_LOG) << "out of memory";
+		return -1;
+	}
+	l->hash = hash;
+	l->len = Wlen[w];
+	memcpy(pilecards(l), W[w], Wlen[w]);
+	l->fp = MemoryManager::fingerprint(pilecards(l), l->len, 0);
+
+	pilenum = Pilenum++;
+	Piles[pilenum] = l;
+	Piletable[i].hash = hash;
+	Piletable[i].id = pilenum + 1;
+
+	/* Keep the load factor below 3/4. */
+
+	if (quint32(Pilenum) * 4 > Piletablesize * 3 && !grow_buckets()) {
+                Status = UnableToDetermineSolvability;
+		return -1;
+	}
+
+#if 0
+if (w < 4) {
+        fprintf( stderr, "get_pile_num %d ", pilenum );
+        for (int i = 0; i < Wlen[w]; ++i) {
+            printcard(W[w][i], stderr);
+        }
+        fprintf( stderr, "\n" );
+}
+#endif
+	return pilenum;
 }
 
+/* Double the size of the pile table. */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::grow_buckets(void)
+{
+	PILESLOT *old = Piletable;
+	quint32 oldsize = Piletablesize;
+	quint32 mask, i, j;
+
+	Piletable = mm->new_array<PILESLOT>(oldsize * 2);
+	if (Piletable == nullptr) {
+		Piletable = old;
+		return false;
+	}
+	Piletablesize = oldsize * 2;
+	mask = Piletablesize - 1;
+
+	for (i = 0; i < oldsize; ++i) {
+		if (old[i].id) {
+			for (j = old[i].hash & mask; Piletable[j].id; j = (j + 1) & mask) {
+			}
+			Piletable[j] = old[i];
+		}
+	}
+	mm->free_array(old, oldsize);
+
+	return true;
+}
+
+/* The piles themselves go away with the block storage. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::free_buckets(void)
+{
+	if (Piletable) {
+		mm->free_array(Piletable, Piletablesize);
+	}
+	Piletable = nullptr;
+	Piletablesize = 0;
+	if (Piles) {
+		mm->free_array(Piles, Pilessize);
+	}
+	Piles = nullptr;
+	Pilessize = 0;
+}
+
+/* Solve patience games.  Prioritized breadth-first search.  Simple breadth-
+first uses exponential memory.  Here the work queue is kept sorted to give
+priority to positions with more cards out, so the solution found is not
+guaranteed to be the shortest, but it'll be better than with a depth-first
+search. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::doit(bool start)
+{
+	int i;
+	POSITION *pos;
+	MOVE m;
+
+	/* Init the queues. */
+
+	for (i = 0; i < NQUEUES; ++i) {
+		Qhead[i] = nullptr;
+	}
+	Qmask[0] = Qmask[1] = 0;
+	Maxq = 0;
+	Qpos = 0;
+	Minpos = 0;
+
+	/* Queue the initial position to get started.  The helpers of a
+	parallel search start with nothing, and wait for their first
+	position in adopt_work(). */
+
+	if (start) {
+		hash_layout();
+		pilesort();
+		m.card_index = -1;
+		m.turn_index = -1;
+		pos = new_position(nullptr, &m);
+		if ( pos == nullptr )
+		{
+		    Status = UnableToDetermineSolvability;
+		}
+		else
+		{
+		    queue_position(pos, 0);
+		}
+	}
+
+	work();
+}
+
+/* Solve it.  In a parallel search, go on with positions from the other
+threads until the search is over. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::work()
+{
+	for (;;) {
+		drain();
+		if (Shared == nullptr || Status != NoSolutionExists || !adopt_work()) {
+			break;
+		}
+	}
+	if (Shared && Status != NoSolutionExists) {
+		Shared->finish(Status, this);
+	}
+}
+
+/* Search the queued positions.  Give some away instead while other threads
+of a parallel search wait for work. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::drain()
+{
+	POSITION *pos;
+	bool q;
+
+	/* Once the search is over, leave the rest of the queue alone: all of
+	it goes with the position store, and unpacking every position just to
+	drop it would only delay the result. */
+
+        while (Status == NoSolutionExists && !interrupted() &&
+	       (pos = dequeue_position()) != nullptr) {
+		if (Shared && Frontier > 0 && Status == NoSolutionExists && Shared->hungry()) {
+			share_position(pos);
+			free_position(pos, true);
+			continue;
+		}
+		q = solve(pos);
+		if (!q) {
+                    free_position(pos, true);
+		}
+	}
+}
+
+/* The configurations of a portfolio search: the queue squashing curves
+(see queue_position()) that the copies of the search use, besides the
+solver's own one.  Steeper and flatter versions of the default, and some
+that ignore or only count the cards out. */
+
+namespace {
+const std::array<qreal, 3> Yparams[] = {
+	{{ 0.0064, 0.64, -6.0 }},
+	{{ 0.0016, 0.16, -1.5 }},
+	{{ 0.0, 0.0, 0.0 }},
+	{{ 0.0, 0.5, -3.0 }},
+	{{ 0.0128, 0.32, -3.0 }},
+	{{ 0.0032, 0.32, -10.0 }},
+	{{ 0.0032, 0.0, 0.0 }},
+};
+constexpr int NCONFIGS = 1 + sizeof(Yparams) / sizeof(Yparams[0]);
+}
+
+/* Run the differently configured copies of the search on their own
+threads and take over the result of the first that comes to a
+conclusion.  They don't share anything but the memory budget. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::race()
+{
+	std::vector<std::unique_ptr<Solver>> racers;
+	std::vector<QThread *> threads;
+	RACE race;
+	int winner;
+
+	for (int i = 1; i < qMin(Portfolio, NCONFIGS); ++i) {
+		Solver *racer = clone();
+		if (racer == nullptr) {
+			break;
+		}
+		racers.emplace_back(racer);
+	}
+	if (racers.empty()) {
+		doit();
+		return;
+	}
+
+	race.done = false;
+	race.winner = -1;
+	race.abort = &m_shouldEnd;
+	Racing = &race;
+	Config = 0;
+	for (size_t i = 0; i < racers.size(); ++i) {
+		Solver *s = racers[i].get();
+		s->Racing = &race;
+		s->Config = i + 1;
+		s->Yparam = Yparams[i];
+		s->max_positions = max_positions;
+		s->mm->share_budget(mm.get());
+		threads.push_back(QThread::create([s] {
+			s->init();
+			if (s->Status == NoSolutionExists) {
+				s->doit();
+			}
+			s->finish_race();
+			s->free();
+		}));
+		threads.back()->start();
+	}
+
+	doit();
+	finish_race();
+
+	for (QThread *thread : threads) {
+		thread->wait();
+		delete thread;
+	}
+	winner = race.winner;
+	for (auto &racer : racers) {
+		if (racer->Config == winner) {
+			Status = racer->Status;
+			m_winMoves = racer->m_winMoves;
+		}
+		Total_moves += racer->Total_moves;
+		Total_generated += racer->Total_generated;
+		Total_positions += racer->Total_positions;
+		Total_compared += racer->Total_compared;
+		Total_mismatched += racer->Total_mismatched;
+		Max_frontier = qMax(Max_frontier, racer->Max_frontier);
+	}
+	m_stats.config = winner;
+	Racing = nullptr;
+}
+
+/* Claim the race if the search came to a conclusion. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::finish_race()
+{
+	int none = -1;
+
+	if (Status == SolutionExists || Status == NoSolutionExists) {
+		Racing->winner.compare_exchange_strong(none, Config);
+		Racing->done = true;
+	}
+}
+
+/* Whether to give up: stopExecution() was called, or another thread came
+to a conclusion already. */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::stopping() const
+{
+	return m_shouldEnd.load() || (Shared && Shared->done()) ||
+	       (Racing && (Racing->done || Racing->abort->load()));
+}
+
+/* Whether to stop before searching the next queued position, because of
+stopping() or the deadline.  Stopping only between positions leaves every
+position that was reached either searched or queued, so the search can go
+on later; see suspend().  Reading the clock costs about as much as a move,
+so only look at it every 64 positions. */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::interrupted()
+{
+	if (stopping()) {
+		Status = SearchAborted;
+		return true;
+	}
+	if (!End.isForever() && (++Polls & 63) == 0 && End.hasExpired()) {
+		Status = DeadlineReached;
+		return true;
+	}
+	return false;
+}
+
+/* The start of a dedicated search, see setDedicatedSearch().  It keeps
+its positions to itself, so there is nothing to go on with. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::begin_dedicated(int _max_positions)
+{
+	max_positions = _max_positions;
+	m_shouldEnd.store(false);
+	m_winMoves.clear();
+	m_firstMoves.clear();
+	Status = NoSolutionExists;
+	mm->reset_peak();
+	Total_moves = 0;
+	Total_positions = 0;
+	Total_generated = 0;
+	Total_compared = 0;
+	Total_mismatched = 0;
+	Frontier = 0;
+	Max_frontier = 0;
+}
+
+/* Whether a dedicated search has to give up before it looks at the next
+position, like solve() and drain() do. */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::dedicated_done()
+{
+	if (max_positions != -1 && Total_positions > (unsigned long)max_positions) {
+		Status = MemoryLimitReached;
+		return true;
+	}
+	return interrupted();
+}
+
+/* Hand the position just dequeued (and unpacked) over to another thread.
+It gets the cards rather than our pile ids, and the moves from the start
+of the search. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::share_position(POSITION *pos)
+{
+	SharedWork work;
+	POSITION *p;
+	int at;
+
+	work.cluster = pos->cluster;
+	for (size_t w = 0; w < NumberPiles; ++w) {
+		work.lens.push_back(Wlen[w]);
+		work.cards.insert(work.cards.end(), W[w], W[w] + Wlen[w]);
+	}
+	work.path = Prefix;
+	at = work.path.size();
+	for (p = pos; p->parent; p = p->parent) {
+		work.path.insert(at, p->move);
+	}
+	Shared->give(std::move(work));
+}
+
+/* Wait for a position from another thread and queue it as the start of a
+new search.  Return false once the parallel search is over. */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::adopt_work()
+{
+	SharedWork work;
+	const card_t *c;
+	POSITION *pos;
+	MOVE m;
+
+	if (!Shared->take(&work)) {
+		return false;
+	}
+
+	c = work.cards.data();
+	for (size_t w = 0; w < NumberPiles; ++w) {
+		Wlen[w] = work.lens[w];
+		memcpy(W[w], c, Wlen[w]);
+		Wp[w] = &W[w][Wlen[w] - 1];
+		c += Wlen[w];
+	}
+	hash_layout();
+	pilesort();
+	unpack_cluster(work.cluster);
+
+	Prefix = work.path;
+	Rootdepth = Prefix.size();
+	m.card_index = -1;
+	m.turn_index = -1;
+	pos = new_position(nullptr, &m);
+	if (pos == nullptr) {
+		Status = UnableToDetermineSolvability;
+		return false;
+	}
+	queue_position(pos, 0);
+	return true;
+}
+
+/* Search with the helpers from clone() on their own threads, and take
+over the result and the numbers of whoever came to a conclusion.  With
+resume, go on with the helpers and the shared state of a parallel search
+that suspend() kept instead. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::parallel_doit(bool resume)
+{
+	std::vector<QThread *> threads;
+
+	if (resume) {
+		Shared->resume();
+	} else {
+		for (int i = 1; i < Threads; ++i) {
+			Solver *helper = clone();
+			if (helper == nullptr) {
+				break;
+			}
+			Helpers.emplace_back(helper);
+		}
+		if (Helpers.empty()) {
+			doit();
+			return;
+		}
+		Shared_search.reset(new SharedSearch(Helpers.size() + 1, mm.get(), &m_shouldEnd));
+		Shared = Shared_search.get();
+	}
+
+	for (auto &helper : Helpers) {
+		Solver *s = helper.get();
+		s->max_positions = max_positions;
+		s->End = End;
+		if (resume) {
+			s->Status = NoSolutionExists;
+			s->Total_moves = s->Total_generated = s->Total_positions = 0;
+			s->Total_compared = s->Total_mismatched = 0;
+			s->Max_frontier = s->Frontier;
+		} else {
+			s->Shared = Shared;
+			s->mm->share_budget(mm.get());
+		}
+		threads.push_back(QThread::create([s, resume] {
+			if (resume) {
+				s->work();
+				return;
+			}
+			s->init();
+			if (s->Status == NoSolutionExists) {
+				s->doit(false);
+			} else {
+				s->Shared->finish(s->Status, s);
+			}
+		}));
+		threads.back()->start();
+	}
+
+	if (resume) {
+		work();
+	} else {
+		doit();
+	}
+
+	for (QThread *thread : threads) {
+		thread->wait();
+		delete thread;
+	}
+	Status = Shared->result();
+	for (auto &helper : Helpers) {
+		if (Status == SolutionExists && Shared->winner() == helper.get()) {
+			m_winMoves = helper->m_winMoves;
+		}
+		Total_moves += helper->Total_moves;
+		Total_generated += helper->Total_generated;
+		Total_positions += helper->Total_positions;
+		Total_compared += helper->Total_compared;
+		Total_mismatched += helper->Total_mismatched;
+		Max_frontier += helper->Max_frontier;
+	}
+}
+
+/* Keep the state of a search that stopped early, unless it came to an end
+for good: the positions and the queues, the pile table, and for a parallel
+search the helpers and what they share.  The next patsolve() of the same
+layout goes on from there with them instead of starting over, whatever
+setThreads() says by then.  Portfolio searches always start over. */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::suspend(quint64 layout)
+{
+	if ((Status != SearchAborted && Status != DeadlineReached) || Portfolio > 1) {
+		return false;
+	}
+	Suspended = true;
+	Suspended_layout = layout;
+	Suspended_first = m_firstMoves;
+	m_stats.piles = Pilenum;
+	m_stats.pileTableSize = Piletablesize;
+	m_stats.spilled = Spill ? Spill->spilled() : 0;
+	return true;
+}
+
+/* Forget the search suspend() kept, if any. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::drop_suspended()
+{
+	if (!Suspended) {
+		return;
+	}
+	Suspended = false;
+	end_parallel();
+	free();
+}
+
+/* Free the helpers of a parallel search and what they shared. */
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::end_parallel()
+{
+	for (auto &helper : Helpers) {
+		helper->free();
+	}
+	Helpers.clear();
+	Shared_search.reset();
+	Shared = nullptr;
+}
+
+/* Fingerprint of the layout to solve, to tell whether a suspended search
+was searching the same one. */
+
+template<size_t NumberPiles>
+quint64 Solver<NumberPiles>::layout_key()
+{
+	std::array<quint8, NumberPiles * (MAXPILE + 1)> key;
+	int len = 0;
+
+	for (size_t w = 0; w < NumberPiles; ++w) {
+		key[len++] = Wlen[w];
+		memcpy(&key[len], W[w], Wlen[w]);
+		len += Wlen[w];
+	}
+	return MemoryManager::fingerprint(key.data(), len, getClusterNumber());
+}
+
+/* Checkpoints.  A suspended search is saved with its position store and
+pile table as they are in memory; the pointers in there are adjusted when
+it is loaded again. */
+
+namespace {
+constexpr quint32 BYTE_ORDER_MARK = 0x01020304;
+}
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::saveCheckpoint(const QString &fileName)
+{
+	if (!Suspended || Shared || Spill) {
+		return false;
+	}
+
+	CheckpointWriter out(fileName);
+	out << quint32(NumberPiles) << quint32(sizeof(POSITION)) << quint32(sizeof(MOVE)) << Compact << Symmetry;
+	out.raw(&BYTE_ORDER_MARK, sizeof(BYTE_ORDER_MARK));
+
+	out << Suspended_layout << quint32(Suspended_first.size());
+	for (const MOVE &m : Suspended_first) {
+		out.raw(&m, sizeof(MOVE));
+	}
+	out << quint64(Total_moves) << quint64(Total_generated) << quint64(Total_positions)
+	    << quint64(Total_compared) << quint64(Total_mismatched)
+	    << quint64(Frontier) << quint64(Max_frontier) << depth_sum
+	    << qint32(Maxq) << qint32(Qpos) << qint32(Minpos);
+	mm->save(out);
+
+	out << Piletablesize;
+	out.raw(Piletable, Piletablesize * sizeof(PILESLOT));
+	out << qint32(Pilenum) << qint32(Pilessize);
+	for (int i = 0; i < Pilenum; ++i) {
+		out << quint64(quintptr(Piles[i]));
+	}
+	for (int q = 0; q < NQUEUES; ++q) {
+		out << quint64(quintptr(Qhead[q]));
+	}
+	out << quint64(quintptr(Freepos));
+	return out.commit();
+}
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::loadCheckpoint(const QString &fileName)
+{
+	CheckpointReader in(fileName);
+	quint32 piles = 0, posbytes = 0, movebytes = 0, order = 0;
+	bool compact = false, symmetry = false;
+
+	in >> piles >> posbytes >> movebytes >> compact >> symmetry;
+	in.raw(&order, sizeof(order));
+	if (!in.ok() || piles != NumberPiles || posbytes != sizeof(POSITION) ||
+	    movebytes != sizeof(MOVE) || compact != Compact || symmetry != Symmetry ||
+	    order != BYTE_ORDER_MARK) {
+		return false;
+	}
+
+	drop_suspended();
+	init();
+	if (Status != NoSolutionExists || !read_checkpoint(in)) {
+		free();
+		return false;
+	}
+	Suspended = true;
+	return true;
+}
 
-/* For each pile, return a unique identifier.  Although there are a
-large number of possible piles, generally fewer than 1000 different
-piles appear in any given game.  We'll use the pile's hash to find
-a hash bucket that contains a short list of piles, along with their
-identifiers. */
+/* The rest of a checkpoint, after the format was found to fit, into the
+store that init() started. */
 
 template<size_t NumberPiles>
-int Solver<NumberPiles>::get_pilenum(int w)
+bool Solver<NumberPiles>::read_checkpoint(CheckpointReader &in)
 {
-	int bucket, pilenum;
-	BUCKETLIST *l, *last;
-
-	/* For a given pile, get its unique pile id.  If it doesn't have
-	one, add it to the appropriate list and give it one.  First, get
-	the hash bucket. */
-
-	bucket = Whash[w] % NBUCKETS;
+	Relocation moved;
+	quint32 nfirst = 0, piletablesize = 0;
+	quint64 moves = 0, generated = 0, positions = 0, compared = 0, mismatched = 0;
+	quint64 frontier = 0, max_frontier = 0, p = 0;
+	qint32 maxq = 0, qpos = 0, minpos = 0, pilenum = 0, pilessize = 0;
+	MOVE m;
 
-	/* Look for the pile in this bucket. */
+	in >> Suspended_layout >> nfirst;
+	Suspended_first.clear();
+	while (nfirst-- > 0 && in.raw(&m, sizeof(MOVE))) {
+		Suspended_first.append(m);
+	}
+	in >> moves >> generated >> positions >> compared >> mismatched >> frontier >> max_frontier >> depth_sum
+	   >> maxq >> qpos >> minpos;
+	if (!in.ok() || maxq < 0 || maxq >= NQUEUES || qpos < 0 || qpos >= NQUEUES ||
+	    minpos < 0 || minpos >= NQUEUES || !mm->restore(in, &moved)) {
+		return false;
+	}
+	if (Compact) {
+		mm->for_each_node(relocate_node, &moved);
+	}
 
-	last = nullptr;
-	for (l = Bucketlist[bucket]; l; l = l->next) {
-		if (l->hash == Whash[w] &&
-		    strncmp((char*)l->pile, (char*)W[w], Wlen[w]) == 0) {
-			break;
-		}
-		last = l;
+	in >> piletablesize;
+	if (!in.ok() || piletablesize < MIN_PILESLOTS || (piletablesize & (piletablesize - 1)) != 0) {
+		return false;
+	}
+	free_buckets();
+	Piletable = mm->new_array<PILESLOT>(piletablesize);
+	if (Piletable == nullptr) {
+		return false;
 	}
+	Piletablesize = piletablesize;
+	in.raw(Piletable, Piletablesize * sizeof(PILESLOT));
 
-	/* If we didn't find it, make a new one and add it to the list. */
+	in >> pilenum >> pilessize;
+	if (!in.ok() || pilessize < int(MIN_PILESLOTS) || pilenum < 0 || pilenum > pilessize) {
+		return false;
+	}
+	Piles = mm->new_array<PILE *>(pilessize);
+	if (Piles == nullptr) {
+		return false;
+	}
+	Pilessize = pilessize;
+	Pilenum = pilenum;
+	for (int i = 0; i < Pilenum; ++i) {
+		in >> p;
+		Piles[i] = moved.at<PILE>(p);
+	}
 
-	if (l == nullptr) {
-		if (Pilenum >= NPILES ) {
-                        Status = UnableToDetermineSolvability;
-			//qCDebug(KPAT_LOG) << "out of piles";
-			return -1;
-		}
-		l = mm_allocate<BUCKETLIST>();
-		if (l == nullptr) {
-                        Status = UnableToDetermineSolvability;
-			//qCDebug(KPAT_LOG) << "out of buckets";
-			return -1;
-		}
-		l->pile = mm_new_array<quint8>(Wlen[w] + 1);
-		if (l->pile == nullptr) {
-                    Status = UnableToDetermineSolvability;
-                    MemoryManager::free_ptr(l);
-		    //qCDebug(KPAT_LOG) << "out of memory";
-                    return -1;
+	Qmask[0] = Qmask[1] = 0;
+	for (int q = 0; q < NQUEUES; ++q) {
+		in >> p;
+		Qhead[q] = relocate_queue(p, &moved);
+		if (Qhead[q]) {
+			Qmask[q >> 6] |= Q_UINT64_C(1) << (q & 63);
 		}
+	}
+	Maxq = maxq;
+	Qpos = qpos;
+	Minpos = minpos;
 
-		/* Store the new pile along with its hash.  Maintain
-		a reverse mapping so we can unpack the piles swiftly. */
+	/* The free list only links the positions through queue. */
 
-		strncpy((char*)l->pile, (char*)W[w], Wlen[w] + 1);
-		l->hash = Whash[w];
-		l->pilenum = pilenum = Pilenum++;
-		l->next = nullptr;
-		if (last == nullptr) {
-			Bucketlist[bucket] = l;
-		} else {
-			last->next = l;
-		}
-		Pilebucket[pilenum] = l;
+	in >> p;
+	Freepos = moved.at<POSITION>(p);
+	for (POSITION *pos = Freepos; pos; pos = pos->queue) {
+		pos->queue = moved.at(pos->queue);
 	}
 
-#if 0
-if (w < 4) {
-        fprintf( stderr, "get_pile_num %d ", l->pilenum );
-        for (int i = 0; i < Wlen[w]; ++i) {
-            printcard(W[w][i], stderr);
-        }
-        fprintf( stderr, "\n" );
-}
-#endif
-	return l->pilenum;
+	Total_moves = moves;
+	Total_generated = generated;
+	Total_positions = positions;
+	Total_compared = compared;
+	Total_mismatched = mismatched;
+	Frontier = frontier;
+	Max_frontier = max_frontier;
+	return in.ok() && moved.ok();
 }
 
+/* Adjust the pointers of a restored queue, and of the positions its
+positions were reached from.  Those are shared, so only the first path
+that reaches one adjusts it. */
+
 template<size_t NumberPiles>
-void Solver<NumberPiles>::free_buckets(void)
+POSITION *Solver<NumberPiles>::relocate_queue(quint64 head, Relocation *moved)
 {
-	int i, j;
-	BUCKETLIST *l, *n;
-
-	for (i = 0; i < NBUCKETS; i++) {
-		l = Bucketlist[i];
-		while (l) {
-			n = l->next;
-			j = strlen((char*)l->pile);    /* @@@ use block? */
-                        MemoryManager::free_array(l->pile, j + 1);
-                        MemoryManager::free_ptr(l);
-			l = n;
+	POSITION *first = moved->at<POSITION>(head);
+	POSITION *pos, *p, *up;
+
+	for (pos = first; pos; pos = pos->queue) {
+		pos->queue = moved->at(pos->queue);
+		pos->node = moved->at(pos->node);
+		for (p = pos;; p = p->parent) {
+			up = p->parent;
+			p->parent = moved->at(up);
+			if (up == nullptr || !moved->visit(up)) {
+				break;
+			}
+			p->parent->queue = nullptr;
+			p->parent->node = moved->at(p->parent->node);
 		}
 	}
+	return first;
 }
 
-/* Solve patience games.  Prioritized breadth-first search.  Simple breadth-
-first uses exponential memory.  Here the work queue is kept sorted to give
-priority to positions with more cards out, so the solution found is not
-guaranteed to be the shortest, but it'll be better than with a depth-first
-search. */
+/* The same for the parent of a delta node, see pack_delta(). */
 
 template<size_t NumberPiles>
-void Solver<NumberPiles>::doit()
+void Solver<NumberPiles>::relocate_node(void *ctx, TREE *node)
 {
-	int i, q;
-	POSITION *pos;
-	MOVE m;
-
-	/* Init the queues. */
-
-	for (i = 0; i < NQUEUES; ++i) {
-		Qhead[i] = nullptr;
-	}
-	Maxq = 0;
-
-	/* Queue the initial position to get started. */
-
-	hash_layout();
-	pilesort();
-	m.card_index = -1;
-        m.turn_index = -1;
-	pos = new_position(nullptr, &m);
-	if ( pos == nullptr )
-        {
-            Status = UnableToDetermineSolvability;
-            return;
-        }
-	queue_position(pos, 0);
-
-	/* Solve it. */
+	quint8 *p = (quint8 *)node + sizeof(TREE);
+	TREE *parent;
 
-        while ((pos = dequeue_position()) != nullptr) {
-		q = solve(pos);
-		if (!q) {
-                    free_position(pos, true);
-		}
+	if (node->keylen & DELTA_KEY) {
+		memcpy(&parent, p, sizeof(TREE *));
+		parent = static_cast<Relocation *>(ctx)->at(parent);
+		memcpy(p, &parent, sizeof(TREE *));
 	}
 }
 
@@ -532,7 +1465,7 @@ bool Solver<NumberPiles>::solve(POSITION *parent)
 	POSITION *pos;
 
         bool q;
-        all_moves++;
+        Total_moves++;
 
 	/* If we've won already (or failed), we just go through the motions
 	but always return false from any position.  This enables the cleanup
@@ -542,14 +1475,9 @@ bool Solver<NumberPiles>::solve(POSITION *parent)
 		return false;
 	}
 
-        if ( m_shouldEnd.load() )
-        {
-            Status = SearchAborted;
-            return false;
-        }
-
 
-        if ( max_positions != -1 && Total_positions > ( unsigned long )max_positions )
+        if ( max_positions != -1 &&
+             ( Shared ? Shared->positions() : Total_positions ) > ( unsigned long )max_positions )
         {
             Status = MemoryLimitReached;
             return false;
@@ -593,13 +1521,13 @@ bool Solver<NumberPiles>::solve(POSITION *parent)
 			continue;
 		}
 
-		/* If this position is in a new cluster, a card went out.
-		Don't queue it, just keep going.  A larger cutoff can also
+		/* If this position is in a new cluster as far as the cards
+		out go (see out_bits()), a card went out.  Don't queue it, just keep going.  A larger cutoff can also
 		force a recursive call, which can help speed things up (but
 		reduces the quality of solutions).  Otherwise, save it for
 		later. */
 
-		if (pos->cluster != parent->cluster || !nmoves) {
+		if (((pos->cluster ^ parent->cluster) & out_bits()) || !nmoves) {
 			qq = solve(pos);
 			undo_move(mp);
 			if (!qq) {
@@ -612,7 +1540,7 @@ bool Solver<NumberPiles>::solve(POSITION *parent)
 			q = true;
 		}
 	}
-        MemoryManager::free_array(mp0, nmoves);
+        mm->free_array(mp0, nmoves);
 
 	/* Return true if this position needs to be kept around. */
 	return q;
@@ -661,7 +1589,6 @@ void Solver<NumberPiles>::queue_position(POSITION *pos, int pri)
 
         int nout = getOuts();
 
-        static qreal Yparam[] = { 0.0032, 0.32, -3.0 };
 	qreal x = (Yparam[0] * nout + Yparam[1]) * nout + Yparam[2];
 	pri += (int)floor(x + .5);
 
@@ -681,10 +1608,40 @@ void Solver<NumberPiles>::queue_position(POSITION *pos, int pri)
 	pos->queue = nullptr;
 	if (Qhead[pri] == nullptr) {
 		Qhead[pri] = pos;
+		Qmask[pri >> 6] |= Q_UINT64_C(1) << (pri & 63);
 	} else {
             pos->queue = Qhead[pri];
             Qhead[pri] = pos;
 	}
+	if (++Frontier > Max_frontier) {
+		Max_frontier = Frontier;
+	}
+}
+
+/* Return the highest non empty queue q with lo <= q < hi, or -1. */
+
+template<size_t NumberPiles>
+int Solver<NumberPiles>::highest_queue(int lo, int hi) const
+{
+	int w;
+	quint64 bits;
+
+	if (hi <= lo) {
+		return -1;
+	}
+	for (w = (hi - 1) >> 6; w >= (lo >> 6); --w) {
+		bits = Qmask[w];
+		if (w == (hi - 1) >> 6 && ((hi - 1) & 63) != 63) {
+			bits &= (Q_UINT64_C(1) << (((hi - 1) & 63) + 1)) - 1;
+		}
+		if (w == lo >> 6) {
+			bits &= ~Q_UINT64_C(0) << (lo & 63);
+		}
+		if (bits) {
+			return (w << 6) + 63 - qCountLeadingZeroBits(bits);
+		}
+	}
+	return -1;
 }
 
 /* Return the position on the head of the queue, or NULL if there isn't one. */
@@ -692,46 +1649,54 @@ void Solver<NumberPiles>::queue_position(POSITION *pos, int pri)
 template<size_t NumberPiles>
 POSITION *Solver<NumberPiles>::dequeue_position()
 {
-	int last;
+	int last, q;
 	POSITION *pos;
-	static int qpos = 0;
-	static int minpos = 0;
 
 	/* This is a kind of prioritized round robin.  We make sweeps
 	through the queues, starting at the highest priority and
 	working downwards; each time through the sweeps get longer.
 	That way the highest priority queues get serviced the most,
 	but we still get lots of low priority action (instead of
-	ignoring it completely). */
+	ignoring it completely).  The empty queues of a sweep are
+	skipped with the bit mask. */
 
 	last = false;
-	do {
-		qpos--;
-		if (qpos < minpos) {
-			if (last) {
-				return nullptr;
-			}
-			qpos = Maxq;
-			minpos--;
-			if (minpos < 0) {
-				minpos = Maxq;
-			}
-			if (minpos == 0) {
-				last = true;
-			}
+	for (;;) {
+		q = highest_queue(Minpos, Qpos);
+		if (q >= 0) {
+			Qpos = q;
+			break;
+		}
+		if (last) {
+			return nullptr;
+		}
+		Qpos = Maxq;
+		Minpos--;
+		if (Minpos < 0) {
+			Minpos = Maxq;
+		}
+		if (Minpos == 0) {
+			last = true;
+		}
+		if (Qhead[Qpos] != nullptr) {
+			break;
 		}
-	} while (Qhead[qpos] == nullptr);
+	}
 
-	pos = Qhead[qpos];
-	Qhead[qpos] = pos->queue;
+	pos = Qhead[Qpos];
+	Qhead[Qpos] = pos->queue;
+	if (Qhead[Qpos] == nullptr) {
+		Qmask[Qpos >> 6] &= ~(Q_UINT64_C(1) << (Qpos & 63));
+	}
+	Frontier--;
 
 	/* Decrease Maxq if that queue emptied. */
 
-	while (Qhead[qpos] == nullptr && qpos == Maxq && Maxq > 0) {
+	while (Qhead[Qpos] == nullptr && Qpos == Maxq && Maxq > 0) {
 		Maxq--;
-		qpos--;
-		if (qpos < minpos) {
-			minpos = qpos;
+		Qpos--;
+		if (Qpos < Minpos) {
+			Minpos = Qpos;
 		}
 	}
 
@@ -747,14 +1712,33 @@ Solver<NumberPiles>::Solver() : mm(new MemoryManager)
 {
     /* Initialize work arrays. */
     for (auto& workspace: W) {
-        workspace = new card_t[84];
-        memset( workspace, 0, sizeof( card_t ) * 84 );
+        workspace = new card_t[MAXPILE];
+        memset( workspace, 0, sizeof( card_t ) * MAXPILE );
+    }
+    Whashlen.fill(0);
+}
+
+/* A solver for the same layout, for the helpers of a parallel search.
+Nothing of a search is copied. */
+
+template<size_t NumberPiles>
+Solver<NumberPiles>::Solver(const Solver &other) : Solver()
+{
+    for (size_t w = 0; w < NumberPiles; ++w) {
+        memcpy(W[w], other.W[w], MAXPILE);
+        Wlen[w] = other.Wlen[w];
+        Wp[w] = &W[w][Wlen[w] - 1];
     }
+    Compact = other.Compact;
+    Symmetry = other.Symmetry;
+    Yparam = other.Yparam;
+    End = other.End;
 }
 
 template<size_t NumberPiles>
 Solver<NumberPiles>::~Solver()
 {
+    drop_suspended();
     for ( size_t i = 0; i < NumberPiles; ++i )
     {
         delete [] W[i];
@@ -765,8 +1749,6 @@ template<size_t NumberPiles>
 void Solver<NumberPiles>::init()
 {
     m_shouldEnd.store(false);
-    init_buckets();
-    mm->init_clusters();
 
     m_winMoves.clear();
     m_firstMoves.clear();
@@ -774,30 +1756,127 @@ void Solver<NumberPiles>::init()
     /* Reset stats. */
 
     Status = NoSolutionExists;
+    Cachenode = nullptr;
+    Prefix.clear();
+    Rootdepth = 0;
+    if (Shared == nullptr && Racing == nullptr) {
+        mm->reset_peak();
+    }
+    if (!Spill_dir.isEmpty() && Threads == 1 && Portfolio == 1 &&
+        Shared == nullptr && Racing == nullptr) {
+        Spill.reset(new SpillSet(mm.get(), Spill_dir));
+    }
+    if (!mm->init_store() || !init_buckets()) {
+        Status = UnableToDetermineSolvability;
+    }
+    Total_moves = 0;
     Total_positions = 0;
     Total_generated = 0;
+    Total_compared = 0;
+    Total_mismatched = 0;
+    Frontier = 0;
+    Max_frontier = 0;
     depth_sum = 0;
 }
 
 template<size_t NumberPiles>
 void Solver<NumberPiles>::free()
 {
+    m_stats.piles = Pilenum;
+    m_stats.pileTableSize = Piletablesize;
+    m_stats.spilled = Spill ? Spill->spilled() : 0;
+    Spill.reset();
     free_buckets();
-    mm->free_clusters();
+    mm->free_store();
     mm->free_blocks();
     Freepos = nullptr;
 }
 
+/* Run the search and keep the numbers for stats(). */
+
 template<size_t NumberPiles>
 SolverInterface::ExitStatus Solver<NumberPiles>::patsolve( int _max_positions )
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_stats = Stats();
+
+    End = Deadline;
+    if (Time_limit >= 0 && QDeadlineTimer(Time_limit) < End) {
+        End = QDeadlineTimer(Time_limit);
+    }
+
+    ExitStatus status = search( _max_positions );
+
+    m_stats.status = status;
+    m_stats.usecs = timer.nsecsElapsed() / 1000;
+    m_stats.moves = Total_moves;
+    m_stats.generated = Total_generated;
+    m_stats.positions = Total_positions;
+    m_stats.compared = Total_compared;
+    m_stats.mismatched = Total_mismatched;
+    m_stats.frontier = Frontier;
+    m_stats.peakFrontier = Max_frontier;
+    m_stats.peakMemory = mm->peak();
+    all_moves += Total_moves;
+    return status;
+}
+
+template<size_t NumberPiles>
+SolverInterface::ExitStatus Solver<NumberPiles>::search( int _max_positions )
 {
     max_positions = _max_positions;
+    const quint64 layout = layout_key();
+
+    /* Go on with the search of this layout that stopped early, if there
+    is one, with the threads it had.  The numbers of stats() then count
+    both parts.  If it has seen more positions than a position limit lets
+    through, a search within the limit cannot get through the layout
+    either; then keep it for a later patsolve() and give up as that search
+    would. */
+
+    bool resume = Suspended && layout == Suspended_layout && Portfolio == 1;
+    if (resume && max_positions >= 0 && Total_positions > (unsigned long)max_positions) {
+        return MemoryLimitReached;
+    }
+    if (resume) {
+        Suspended = false;
+        m_shouldEnd.store(false);
+        m_winMoves.clear();
+        m_firstMoves = Suspended_first;
+        Status = NoSolutionExists;
+    } else {
+        drop_suspended();
 
-    /* Initialize the suitable() macro variables. */
-    init();
+        /* Initialize the suitable() macro variables. */
+        init();
+
+        /* Some deals are lost for reasons a quick look shows. */
+        if (Status == NoSolutionExists && dead_deal()) {
+            m_stats.refuted = true;
+        }
+    }
 
     /* Go to it. */
-    doit();
+    if (Status == NoSolutionExists && !m_stats.refuted) {
+        if (Portfolio > 1) {
+            race();
+        } else if (Shared || (!resume && Threads > 1)) {
+            parallel_doit(resume);
+        } else if (resume) {
+            work();
+        } else {
+            doit();
+        }
+    }
+
+    if (suspend(layout)) {
+        if (Status == SearchAborted) {
+            m_firstMoves.clear();
+        }
+        return Status;
+    }
+    end_parallel();
 
     if ( Status == SearchAborted ) // thread quit
     {
@@ -806,8 +1885,6 @@ SolverInterface::ExitStatus Solver<NumberPiles>::patsolve( int _max_positions )
     }
 #if 0
     printf("%ld positions generated (%f).\n", Total_generated, depth_sum / Total_positions);
-    printf("%ld unique positions.\n", Total_positions);
-    printf("Mem_remain = %ld\n", ( long int )mm->Mem_remain);
 #endif
     free();
     return Status;
@@ -831,11 +1908,243 @@ QList<MOVE> Solver<NumberPiles>::firstMoves() const
     return m_firstMoves;
 }
 
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setMemoryBudget(size_t bytes)
+{
+    mm->set_budget(bytes);
+}
+
+template<size_t NumberPiles>
+size_t Solver<NumberPiles>::memoryBudget() const
+{
+    return mm->budget();
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setDeadline(QDeadlineTimer deadline)
+{
+    Deadline = deadline;
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setTimeLimit(qint64 msecs)
+{
+    Time_limit = msecs;
+}
+
+template<size_t NumberPiles>
+SolverInterface::Stats Solver<NumberPiles>::stats() const
+{
+    return m_stats;
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setLargePages(bool on)
+{
+    drop_suspended();
+    mm->set_large_pages(on);
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setCompactPositions(bool on)
+{
+    if (on != Compact) {
+        drop_suspended();
+    }
+    Compact = on;
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setSymmetryReduction(bool on)
+{
+    if (on != Symmetry) {
+        drop_suspended();
+    }
+    Symmetry = on;
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setSpillDirectory(const QString &dir)
+{
+    Spill_dir = dir;
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setDedicatedSearch(bool on)
+{
+    Dedicated = on;
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setThreads(int n)
+{
+    Threads = qMax(1, n);
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setPortfolio(int n)
+{
+    Portfolio = qMax(1, n);
+}
+
+template<size_t NumberPiles>
+QVector<qreal> Solver<NumberPiles>::parameters() const
+{
+    QVector<qreal> p;
+
+    for (qreal y : Yparam) {
+        p.append(y);
+    }
+    return p + moveParameters();
+}
+
+template<size_t NumberPiles>
+void Solver<NumberPiles>::setParameters(const QVector<qreal> &p)
+{
+    int n = qMin(p.size(), int(Yparam.size()));
+
+    std::copy(p.begin(), p.begin() + n, Yparam.begin());
+    if (p.size() > n) {
+        setMoveParameters(p.mid(n));
+    }
+}
+
+/* Move priorities must fit in a MOVE.  127 is what automoves get; a
+game may take a priority tuned all the way up as one, as Gypsy does. */
+
+template<size_t NumberPiles>
+int Solver<NumberPiles>::movePriority(qreal p)
+{
+    return qBound(-127, qRound(p), 127);
+}
+
+/* Same moves get_moves() finds for the first position of a search, but
+without setting up the position store for one. */
+
+template<size_t NumberPiles>
+QList<MOVE> Solver<NumberPiles>::legalMoves()
+{
+    QList<MOVE> moves;
+    int a = false, numout = 0;
+
+    int n = get_possible_moves(&a, &numout);
+    if (n > 0 && !a) {
+        prioritize(Possible, n);
+    }
+    moves.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        moves.append(Possible[i]);
+    }
+    return moves;
+}
+
 template<size_t NumberPiles>
 void Solver<NumberPiles>::print_layout()
 {
 }
 
+/* For games that build down in alternate colors and send kings to empty
+piles, like Klondike and Yukon: whether some cards of the first npiles
+piles can never move, which loses the game.  Only cards on face down
+cards, or on cards that are stuck too, can be stuck; the cards under
+them can't go anywhere before they do.  Such a card moves out, which
+needs the lower cards of its suit out first, or onto one of the two
+cards of the other color and the next rank.  All of them are taken to be
+stuck at first, and those that could move as long as the others don't
+are let go until none is left, or none of them could ever be the first
+to move.  Kings may go to an empty pile, so they are left alone, and
+cards on other piles are taken to be free.  This finds a few lost deals
+only, but never a good one. */
+
+template<size_t NumberPiles>
+bool Solver<NumberPiles>::stuck_card(int npiles) const
+{
+	int pile[64], at[64];       /* where each card is, by suit and rank */
+	bool stuck[64];
+	int top[NumberPiles];       /* the highest stuck card of a pile, or -1 */
+	bool changed;
+
+	std::fill(pile, pile + 64, -1);
+	std::fill(stuck, stuck + 64, false);
+	for (size_t w = 0; w < NumberPiles; ++w) {
+		for (int i = 0; i < Wlen[w]; ++i) {
+			const card_t card = W[w][i] & 0x3F;
+			pile[card] = w;
+			at[card] = i;
+		}
+		top[w] = -1;
+	}
+
+	/* Let go of the cards of pile w on one that moves. */
+
+	auto settle = [&](int w) {
+		top[w] = -1;
+		for (int i = 0; i < Wlen[w]; ++i) {
+			const card_t card = W[w][i] & 0x3F;
+			if (i > 0 && !DOWN(W[w][i - 1]) && !stuck[W[w][i - 1] & 0x3F]) {
+				stuck[card] = false;
+			} else if (stuck[card]) {
+				top[w] = i;
+			}
+		}
+	};
+
+	/* Whether a card stays under a stuck one for good, or is gone.  To
+	go out, the stuck card itself counts too; it may still take cards
+	though. */
+
+	auto buried = [&](card_t card, bool out) {
+		const int p = pile[card];
+		if (p < 0) {
+			return true;
+		}
+		return p < npiles && at[card] < top[p] + out;
+	};
+
+	for (int w = 0; w < npiles; ++w) {
+		for (int i = 0; i < Wlen[w]; ++i) {
+			const card_t card = W[w][i] & 0x3F;
+			stuck[card] = RANK(card) != PS_KING;
+		}
+		settle(w);
+	}
+
+	do {
+		changed = false;
+		for (int w = 0; w < npiles; ++w) {
+			for (int i = 0; i <= top[w]; ++i) {
+				const card_t card = W[w][i] & 0x3F;
+				const int suit = SUIT(card), rank = RANK(card);
+				bool blocked = false, targets = true;
+
+				if (!stuck[card]) {
+					continue;
+				}
+				for (int r = PS_ACE; r < rank && !blocked; ++r) {
+					const card_t lower = (suit << 4) + r;
+					blocked = pile[lower] >= 0 && buried(lower, true);
+				}
+				for (int s = 1; s < 4 && blocked && targets; s += 2) {
+					const card_t target = (((suit + s) & 3) << 4) + rank + 1;
+					targets = buried(target, false);
+				}
+				if (!blocked || !targets) {
+					stuck[card] = false;
+					settle(w);
+					changed = true;
+				}
+			}
+		}
+	} while (changed);
+
+	for (int w = 0; w < npiles; ++w) {
+		if (top[w] >= 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 template<size_t NumberPiles>
 int Solver<NumberPiles>::translateSuit( int s )
 {
@@ -864,37 +2173,70 @@ int Solver<NumberPiles>::translate_pile(const KCardPile *pile, card_t *w, int si
 	return pile->count();
 }
 
-/* Insert key into the tree unless it's already there.  Return true if
-it was new. */
+/* Insert key into the position table unless it's already there.  Return
+NEW if it was new. */
 
 template<size_t NumberPiles>
-MemoryManager::inscode Solver<NumberPiles>::insert(unsigned int *cluster, int d, TREE **node)
+MemoryManager::inscode Solver<NumberPiles>::insert(unsigned int *cluster, int d, TREE **node, TREE *parent)
 {
 	/* Get the cluster number from the Out cell contents. */
 
         unsigned int k = getClusterNumber();
         *cluster = k;
 
-        /* Get the tree for this cluster. */
+	/* Most positions have been seen before, and only their fingerprint
+	is needed to tell; the node is only packed for new ones. */
 
-	TREELIST *tl = mm->cluster_tree(k);
-	if (tl == nullptr) {
-		return MemoryManager::ERR;
-	}
+        if (!pack_key()) {
+                return MemoryManager::ERR;
+        }
+        Total_generated++;
 
-	/* Create a compact position representation. */
+        MemoryManager::inscode i2;
+        TREE *newtree = nullptr;
+        if (Spill && !Shared) {
 
-	TREE *newtree = pack_position();
-	if (newtree == nullptr) {
-		return MemoryManager::ERR;
-	}
-        Total_generated++;
+                /* Only the fingerprint is kept, new_position() stores
+                the key. */
+
+                i2 = Spill->visit(key_fingerprint(k));
+        } else if (Shared) {
+
+                /* Only the shared visited set is used.  A position handed
+                over by another thread is in there already. */
 
-        MemoryManager::inscode i2 = mm->insert_node(newtree, d, &tl->tree, node);
+                i2 = Shared->visit(layout_fingerprint(k));
+                if (i2 == MemoryManager::FOUND && parent == nullptr) {
+                        i2 = MemoryManager::NEW;
+                }
+                if (i2 == MemoryManager::NEW) {
+                        newtree = pack_position(parent, d);
+                        if (newtree == nullptr) {
+                                return MemoryManager::ERR;
+                        }
+                        newtree->cluster = k;
+                        newtree->depth = d;
+                }
+        } else {
+                const unsigned long compared = Total_compared;
+                quint64 fp = key_fingerprint(k);
+                i2 = mm->find_node(fp, k, node, same_position, this);
+                if (i2 == MemoryManager::FOUND) {
+                        Total_mismatched += Total_compared - compared - 1;
+                        return i2;
+                }
+                Total_mismatched += Total_compared - compared;
+                newtree = pack_position(parent, d);
+                if (newtree == nullptr) {
+                        return MemoryManager::ERR;
+                }
+                i2 = mm->add_node(newtree, fp, k, d);
+        }
 
-	if (i2 != MemoryManager::NEW) {
-		mm->give_back_block((quint8 *)newtree);
+	if (i2 == MemoryManager::ERR) {
+		Status = UnableToDetermineSolvability;
 	}
+	*node = newtree;
 
 	return i2;
 }
@@ -912,14 +2254,17 @@ POSITION *Solver<NumberPiles>::new_position(POSITION *parent, MOVE *m)
 	then ignore it and return (unless this position is better). */
 
 	if (parent == nullptr) {
-		depth = 0;
+		depth = Rootdepth;
 	} else {
 		depth = parent->depth + 1;
 	}
-        MemoryManager::inscode i = insert(&cluster, depth, &node);
+        MemoryManager::inscode i = insert(&cluster, depth, &node, parent ? parent->node : nullptr);
         if (i == MemoryManager::NEW) {
                 Total_positions++;
                 depth_sum += depth;
+                if (Shared) {
+                        Shared->add_position();
+                }
         } else
             return nullptr;
 
@@ -939,6 +2284,21 @@ POSITION *Solver<NumberPiles>::new_position(POSITION *parent, MOVE *m)
 		}
 	}
 
+	/* With a spilled visited set, the key goes with the position. */
+
+	if (node == nullptr) {
+		if (sizeof(TREE) + Keylen <= size_t(Spillbytes)) {
+			node = (TREE *)(p + Posbytes - Spillbytes);
+		} else if ((node = (TREE *)mm->new_from_block(Treebytes)) == nullptr) {
+			Status = UnableToDetermineSolvability;
+			return nullptr;
+		}
+		node->cluster = cluster;
+		node->depth = depth;
+		node->keylen = Keylen;
+		memcpy(node + 1, Keybuf.data(), Keylen);
+	}
+
 	pos = (POSITION *)p;
 	pos->queue = nullptr;
 	pos->parent = parent;
@@ -949,10 +2309,12 @@ POSITION *Solver<NumberPiles>::new_position(POSITION *parent, MOVE *m)
 	pos->nchild = 0;
 #if 0
         QString dummy;
-        quint16 *t = ( quint16* )( ( char* )node + sizeof( TREE ) );
+        const quint8 *t = ( const quint8* )node + sizeof( TREE );
         for ( int i = 0; i < NumberPiles; ++i )
         {
-            QString s = "      " + QString( "%1" ).arg( ( int )t[i] );
+            quint32 id;
+            t = get_pileid( t, &id );
+            QString s = "      " + QString( "%1" ).arg( id );
             dummy += s.right( 5 );
         }
         if ( Total_positions % 1000 == 1000 )
@@ -963,12 +2325,33 @@ POSITION *Solver<NumberPiles>::new_position(POSITION *parent, MOVE *m)
 	return pos;
 }
 
-/* Hash the whole layout.  This is called once, at the start. */
+/* The fingerprint of the position for the visited set of a parallel
+search.  It is made of the fingerprints of the piles, since the pile ids
+differ from thread to thread. */
+
+template<size_t NumberPiles>
+quint64 Solver<NumberPiles>::layout_fingerprint(quint32 cluster) const
+{
+	quint64 fps[NumberPiles];
+
+	for (size_t w = 0; w < NumberPiles; ++w) {
+		fps[w] = Piles[Wpilenum[w]]->fp;
+	}
+	if (const quint8 *classes = Symmetry ? pile_classes() : nullptr) {
+		sort_classes(fps, classes, NumberPiles);
+	}
+	return MemoryManager::fingerprint((const quint8 *)fps, sizeof(fps), cluster);
+}
+
+/* Hash the whole layout.  This is called at the start of a search, and for
+the positions handed over by other threads. */
 
 template<size_t NumberPiles>
 void Solver<NumberPiles>::hash_layout(void)
 {
 	for (size_t w = 0; w < NumberPiles; w++) {
+		Whash[w] = 0;
+		Whashlen[w] = 0;
 		hashpile(w);
 	}
 }
@@ -31,6 +31,7 @@
 #include <atomic>
 #include <memory>
 #include <array>
+#include <vector>
 #include <cstdio>
 
 /* A card is represented as ( down << 6 ) + (suit << 4) + rank. */
@@ -47,7 +48,34 @@ struct POSITION {
 	quint8 nchild;          /* number of child nodes left */
 };
 
+/* A stored pile.  The cards follow the struct. */
+
+struct PILE {
+	quint64 fp;             /* fingerprint of the cards, see layout_fingerprint() */
+	quint32 hash;           /* the pile's hash code */
+	quint8 len;             /* the number of cards */
+};
+
+inline card_t *pilecards(PILE *pile) {return (card_t *)(pile + 1);}
+
+struct PILESLOT {
+	quint32 hash;
+	quint32 id;             /* the pile's id plus one, 0 if the slot is empty */
+};
+
 class MemoryManager;
+class SharedSearch;
+class SpillSet;
+class CheckpointReader;
+class Relocation;
+
+/* What the solvers of a portfolio search share, see race(). */
+
+struct RACE {
+	std::atomic_bool done;          /* somebody came to a conclusion */
+	std::atomic<int> winner;        /* the configuration that did */
+	const std::atomic_bool *abort;  /* the first solver's stopExecution() */
+};
 
 template<size_t NumberPiles>
 class Solver : public SolverInterface
@@ -57,18 +85,57 @@ public:
 
     Solver();
     virtual ~Solver();
-    ExitStatus patsolve( int max_positions = -1) override;
+    ExitStatus patsolve( int max_positions = -1) final override;
     bool recursive(POSITION *pos = nullptr);
     void translate_layout() override = 0;
     MoveHint translateMove(const MOVE &m ) override = 0;
     void stopExecution() final override;
     QList<MOVE> firstMoves() const final override;
     QList<MOVE> winMoves() const final override;
+    QList<MOVE> legalMoves() final override;
+    void setMemoryBudget(size_t bytes) final override;
+    size_t memoryBudget() const final override;
+    void setDeadline(QDeadlineTimer deadline) final override;
+    void setTimeLimit(qint64 msecs) final override;
+    void setLargePages(bool on) final override;
+    void setCompactPositions(bool on) final override;
+    void setSymmetryReduction(bool on) final override;
+    void setSpillDirectory(const QString &dir) final override;
+    void setDedicatedSearch(bool on) final override;
+    void setThreads(int n) final override;
+    void setPortfolio(int n) final override;
+    bool saveCheckpoint(const QString &fileName) final override;
+    bool loadCheckpoint(const QString &fileName) final override;
+    QVector<qreal> parameters() const override;
+    void setParameters(const QVector<qreal> &p) override;
+    Stats stats() const final override;
 
 protected:
+    Solver(const Solver &other);
+    virtual Solver *clone() const { return nullptr; }
+    virtual ExitStatus search(int max_positions);
     MOVE *get_moves(int *nmoves);
     bool solve(POSITION *parent);
-    void doit();
+    void doit(bool start = true);
+    void work();
+    void drain();
+    void parallel_doit(bool resume = false);
+    bool suspend(quint64 layout);
+    void drop_suspended();
+    void end_parallel();
+    quint64 layout_key();
+    bool read_checkpoint(CheckpointReader &in);
+    POSITION *relocate_queue(quint64 head, Relocation *moved);
+    static void relocate_node(void *ctx, TREE *node);
+    void race();
+    void finish_race();
+    bool stopping() const;
+    bool interrupted();
+    void share_position(POSITION *pos);
+    bool adopt_work();
+    quint64 layout_fingerprint(quint32 cluster) const;
+    void begin_dedicated(int max_positions);
+    bool dedicated_done();
     void win(POSITION *pos);
     virtual int get_possible_moves(int *a, int *numout) = 0;
     int translateSuit( int s );
@@ -76,13 +143,22 @@ protected:
 	void queue_position(POSITION *pos, int pri);
     void free_position(POSITION *pos, int);
     POSITION *dequeue_position();
+    int highest_queue(int lo, int hi) const;
     void hashpile(int w);
+    void rehashpile(int w, int i);
     POSITION *new_position(POSITION *parent, MOVE *m);
-    TREE *pack_position(void);
+    TREE *pack_position(TREE *parent, int depth);
+    bool pack_key();
+    quint64 key_fingerprint(quint32 cluster);
+    bool pack_delta(TREE *parent, TREE **node);
     void unpack_position(POSITION *pos);
-    void init_buckets(void);
+    void node_pilenums(const TREE *node, int *ids);
+    void cache_pilenums(const TREE *node);
+    static bool same_position(void *ctx, const TREE *node);
+    bool init_buckets(void);
+    bool grow_buckets(void);
     int get_pilenum(int w);
-    MemoryManager::inscode insert(unsigned int *cluster, int d, TREE **node);
+    MemoryManager::inscode insert(unsigned int *cluster, int d, TREE **node, TREE *parent);
     void free_buckets(void);
     void printcard(card_t card, FILE *outfile);
     int translate_pile(const KCardPile *pile, card_t *w, int size);
@@ -93,10 +169,35 @@ protected:
     virtual void make_move(MOVE *m) = 0;
     virtual void undo_move(MOVE *m) = 0;
     virtual void prioritize(MOVE *mp0, int n);
+    virtual QVector<qreal> moveParameters() const { return {}; }
+    virtual void setMoveParameters(const QVector<qreal> &) {}
+    static int movePriority(qreal p);
     virtual bool isWon() = 0;
     virtual int getOuts() = 0;
     virtual unsigned int getClusterNumber() { return 0; }
+
+    /* Restore what getClusterNumber() kept of a position that is unpacked;
+    its piles and their ids in Wpilenum are in place by then. */
     virtual void unpack_cluster( unsigned int  ) {}
+
+    /* The bits of the cluster that tell the cards out; solve() goes on
+    right away with a position that differs from its parent's in them.
+    A game may keep more of the position in the other bits. */
+    virtual unsigned int out_bits() const { return ~0u; }
+
+    /* Piles that can trade places without changing what can be done with
+    the position: piles with the same nonzero class here.  With
+    setSymmetryReduction(), positions that only differ in the order of such
+    piles are taken for one.  This may depend on the position, but only on
+    the piles of class 0 and the cluster.  Null for none. */
+    virtual const quint8 *pile_classes() const { return nullptr; }
+
+    /* Whether the translated layout is lost for sure, by a look at it
+    that is much quicker than a search.  False if in doubt.  A search
+    that doesn't go on with an earlier one asks first. */
+    virtual bool dead_deal() { return false; }
+    bool stuck_card(int npiles) const;
+
     void init();
     void free();
 
@@ -108,6 +209,8 @@ protected:
 
     /* Every different pile has a hash and a unique id. */
     std::array<quint32, NumberPiles> Whash;
+    std::array<std::array<card_t, 84>, NumberPiles> Wshadow; /* the cards Whash is made of */
+    std::array<int, NumberPiles> Whashlen;
     std::array<int, NumberPiles> Wpilenum = {}; // = {} for zero initialization
 
     /* Position freelist. */
@@ -120,14 +223,104 @@ protected:
     std::unique_ptr<MemoryManager> mm;
     ExitStatus Status;             /* win, lose, or fail */
 
+    /* Pile store.  All of this is per instance (as is everything the
+    MemoryManager hands out), so independent solvers may run on
+    different threads at the same time. */
+
+    static constexpr int MAXPILEID = 1 << 30;       /* see put_pileid() */
+    static constexpr quint32 MIN_PILESLOTS = 1024;  /* a power of two */
+
+    PILESLOT *Piletable = nullptr;
+    quint32 Piletablesize = 0;
+    PILE **Piles = nullptr;         /* reverse lookup for unpack to get the pile
+                                       from its id */
+    int Pilessize = 0;
+    int Pilenum;                    /* the next pile number to be assigned */
+
+    int Treebytes;                  /* largest size of a packed position */
+
+    /* Compact positions: most nodes only store the piles that differ
+    from their parent's node; see pack_delta(). */
+
+    static constexpr int KEYFRAME_DEPTH = 8;      /* a full key every 8 moves */
+    static constexpr quint16 DELTA_KEY = 0x8000;  /* in TREE::keylen */
+
+    bool Compact = false;
+    std::array<quint8, NumberPiles * 4> Keybuf;  /* the full key of the new position */
+    int Keylen;
+    const TREE *Cachenode = nullptr;             /* the node Cacheids belong to */
+    std::array<int, NumberPiles> Cacheids;
+
+    /* The new position with its interchangeable piles in order, which is
+    what its fingerprint is made of; see pile_classes(). */
+
+    bool Symmetry = false;
+    const quint8 *Classes = nullptr;
+    std::array<int, NumberPiles> Canonids;
+
+    int Posbytes;                   /* size of a POSITION, aligned */
+
+    /* The visited set of a search that may outgrow memory, see
+    setSpillDirectory(); without it, the position table of the
+    MemoryManager. */
+
+    QString Spill_dir;
+    std::unique_ptr<SpillSet> Spill;
+    int Spillbytes;                 /* of a position, for its key */
+
+    /* Search with the game's own search() instead, for the games that
+    have one; see setDedicatedSearch(). */
+
+    bool Dedicated = false;
+
     static constexpr auto NQUEUES = 127;
 
     POSITION *Qhead[NQUEUES]; /* separate queue for each priority */
+    quint64 Qmask[2];         /* bit q is set if Qhead[q] is not empty */
     int Maxq;
+    int Qpos, Minpos;         /* dequeue_position()'s round robin state */
+    unsigned long Frontier;   /* positions in the queues */
+    unsigned long Max_frontier;
+    Stats m_stats;
 
-    unsigned long Total_generated, Total_positions;
+    unsigned long Total_moves, Total_generated, Total_positions;
+    unsigned long Total_compared;   /* stored positions same_position() looked at */
+    unsigned long Total_mismatched; /* of them, other positions than the new one */
     qreal depth_sum;
 
+    /* Parallel search.  Positions handed over by another thread are
+    searched from as if they were the start; Prefix holds the moves that
+    lead to them. */
+
+    int Threads = 1;
+    SharedSearch *Shared = nullptr;
+    std::vector<std::unique_ptr<Solver>> Helpers;       /* ours, if any */
+    std::unique_ptr<SharedSearch> Shared_search;
+    QList<MOVE> Prefix;
+    int Rootdepth = 0;
+
+    /* Portfolio search.  Yparam is the queue squashing curve of
+    queue_position(), which is what the configurations differ in. */
+
+    int Portfolio = 1;
+    RACE *Racing = nullptr;
+    int Config = 0;
+    std::array<qreal, 3> Yparam = {{ 0.0032, 0.32, -3.0 }};
+
+    /* The deadline of the running patsolve(): the earlier of Deadline and
+    Time_limit from its start. */
+
+    QDeadlineTimer Deadline{QDeadlineTimer::Forever};
+    qint64 Time_limit = -1;
+    QDeadlineTimer End{QDeadlineTimer::Forever};
+    unsigned int Polls = 0;         /* see interrupted() */
+
+    /* A search that stopped early and can go on, see suspend(). */
+
+    bool Suspended = false;
+    quint64 Suspended_layout = 0;
+    QList<MOVE> Suspended_first;
+
     POSITION *Stack = nullptr;
     QMap<qint32,bool> recu_pos;
     int max_positions;
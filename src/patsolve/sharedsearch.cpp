@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sharedsearch.h"
+
+// Qt
+#include <QMutexLocker>
+
+SharedSearch::SharedSearch(int workers, MemoryManager *account, const std::atomic_bool *abort)
+    : Account(account)
+    , Abort(abort)
+    , Positions(0)
+    , Pending(0)
+    , Idle(0)
+    , Workers(workers)
+    , Done(false)
+    , Result(SolverInterface::NoSolutionExists)
+    , Winner(nullptr)
+{
+}
+
+SharedSearch::~SharedSearch()
+{
+	for (Shard &shard : Shards) {
+		if (shard.slots) {
+			Account->free_array(shard.slots, shard.size);
+		}
+	}
+}
+
+/* Add a position to the visited set unless it's already there.  The shard
+is picked by the top bits of the fingerprint, the slot by the low ones.
+Two different positions with the same 64 bit fingerprint would be taken
+for one; that is unlikely enough to be ignored. */
+
+MemoryManager::inscode SharedSearch::visit(quint64 fp)
+{
+	Shard *shard = &Shards[fp >> (64 - SHARD_BITS)];
+	size_t mask, i;
+
+	if (fp == 0) {
+		fp = 1;
+	}
+
+	QMutexLocker locker(&shard->lock);
+	if (shard->slots == nullptr) {
+		shard->slots = Account->new_array<quint64>(MIN_SLOTS);
+		if (shard->slots == nullptr) {
+			return MemoryManager::ERR;
+		}
+		shard->size = MIN_SLOTS;
+	}
+
+	mask = shard->size - 1;
+	for (i = fp & mask; shard->slots[i]; i = (i + 1) & mask) {
+		if (shard->slots[i] == fp) {
+			return MemoryManager::FOUND;
+		}
+	}
+	shard->slots[i] = fp;
+
+	/* Like the position table of a single solver: keep the load factor
+	below 3/4 while there's memory, but never let the shard fill up. */
+
+	++shard->used;
+	if (shard->used * 4 > shard->size * 3 && !grow(shard) &&
+	    shard->used * 64 > shard->size * 63) {
+		return MemoryManager::ERR;
+	}
+	return MemoryManager::NEW;
+}
+
+bool SharedSearch::grow(Shard *shard)
+{
+	quint64 *old = shard->slots;
+	size_t oldsize = shard->size;
+	size_t mask, i, j;
+
+	quint64 *t = Account->new_array<quint64>(oldsize * 2);
+	if (t == nullptr) {
+		return false;
+	}
+	shard->slots = t;
+	shard->size = oldsize * 2;
+	mask = shard->size - 1;
+
+	for (i = 0; i < oldsize; ++i) {
+		if (old[i]) {
+			for (j = old[i] & mask; t[j]; j = (j + 1) & mask) {
+			}
+			t[j] = old[i];
+		}
+	}
+	Account->free_array(old, oldsize);
+
+	return true;
+}
+
+/* Hand a position over to a solver that waits for work. */
+
+void SharedSearch::give(SharedWork &&work)
+{
+	QMutexLocker locker(&Lock);
+	Work.push_back(std::move(work));
+	Pending = Work.size();
+	Wakeup.wakeOne();
+}
+
+/* Wait for a position to search.  Return false if the search is over
+instead; if that is because nobody had anything left to search, the
+result is that there is no solution. */
+
+bool SharedSearch::take(SharedWork *work)
+{
+	QMutexLocker locker(&Lock);
+
+	++Idle;
+	while (Work.empty() && !done()) {
+		if (Idle == Workers) {
+			Done = true;
+			break;
+		}
+
+		/* The abort flag is not ours to signal, so look at it now and
+		then. */
+
+		Wakeup.wait(&Lock, 50);
+	}
+	--Idle;
+
+	if (done()) {
+		if (Abort->load() && Result == SolverInterface::NoSolutionExists) {
+			Result = SolverInterface::SearchAborted;
+		}
+		Done = true;
+		Wakeup.wakeAll();
+		return false;
+	}
+
+	*work = std::move(Work.front());
+	Work.pop_front();
+	Pending = Work.size();
+	return true;
+}
+
+/* A solver came to a conclusion, or failed; the first one counts.  Stop
+the others. */
+
+void SharedSearch::finish(SolverInterface::ExitStatus status, const void *by)
+{
+	QMutexLocker locker(&Lock);
+	if (!Done) {
+		Result = status;
+		Winner = by;
+		Done = true;
+	}
+	Wakeup.wakeAll();
+}
+
+/* Go on after the search was stopped.  The visited set and the work that
+was waiting stay as they are. */
+
+void SharedSearch::resume()
+{
+	QMutexLocker locker(&Lock);
+	Done = false;
+	Result = SolverInterface::NoSolutionExists;
+	Winner = nullptr;
+}
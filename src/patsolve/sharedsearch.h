@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHAREDSEARCH_H
+#define SHAREDSEARCH_H
+
+// own
+#include "memory.h"
+#include "solverinterface.h"
+// Qt
+#include <QMutex>
+#include <QWaitCondition>
+// Std
+#include <atomic>
+#include <deque>
+#include <vector>
+
+/* A position handed from one thread of a parallel search to another: the
+cards of every pile, the cluster, and the moves that lead to it from the
+start of the search. */
+
+struct SharedWork {
+	quint32 cluster = 0;
+	std::vector<card_t> cards;      /* all piles, one after the other */
+	std::vector<quint8> lens;       /* the number of cards of each pile */
+	QList<MOVE> path;
+};
+
+/* What the solvers of a parallel search share.  Every position that any
+of them has seen is in one visited set, by its fingerprint only; the set
+is split in shards with a lock each.  Each solver searches its own queue;
+the ones that run out of work wait here, and the busy ones hand over
+positions while anybody waits (see hungry()).  The search is over once a
+solver comes to a conclusion, or when all of them wait at the same time.
+A search that was stopped can go on with everything it had seen and the
+work nobody had taken yet, see resume(). */
+
+class SharedSearch
+{
+public:
+    SharedSearch(int workers, MemoryManager *account, const std::atomic_bool *abort);
+    ~SharedSearch();
+
+    MemoryManager::inscode visit(quint64 fp);
+
+    void add_position() { Positions.fetch_add(1, std::memory_order_relaxed); }
+    unsigned long positions() const { return Positions.load(std::memory_order_relaxed); }
+
+    bool hungry() const { return Pending.load() < Idle.load(); }
+    void give(SharedWork &&work);
+    bool take(SharedWork *work);
+
+    void finish(SolverInterface::ExitStatus status, const void *by);
+    void resume();
+    bool done() const { return Done.load() || Abort->load(); }
+    SolverInterface::ExitStatus result() const { return Result; }
+    const void *winner() const { return Winner; }
+
+private:
+    static constexpr int SHARD_BITS = 6;
+    static constexpr size_t MIN_SLOTS = 1024;      /* per shard, a power of two */
+
+    struct Shard {
+        QMutex lock;
+        quint64 *slots = nullptr;                  /* 0 is an empty slot */
+        size_t size = 0;
+        size_t used = 0;
+    };
+
+    bool grow(Shard *shard);
+
+    MemoryManager *Account;
+    const std::atomic_bool *Abort;
+    Shard Shards[1 << SHARD_BITS];
+    std::atomic<unsigned long> Positions;
+
+    QMutex Lock;                    /* for all of the below */
+    QWaitCondition Wakeup;
+    std::deque<SharedWork> Work;
+    std::atomic<int> Pending;       /* Work.size() */
+    std::atomic<int> Idle;          /* solvers waiting in take() */
+    int Workers;
+    std::atomic_bool Done;
+    SolverInterface::ExitStatus Result;
+    const void *Winner;
+};
+
+#endif // SHAREDSEARCH_H
@@ -58,11 +58,11 @@ void SimonSolver::make_move(MOVE *m)
             O[to] = SUIT( *Wp[from] );
             Wlen[from] -= 13;
             Wp[from] -= 13;
-            hashpile( from );
             if ( Wlen[from] && DOWN( *Wp[from] ) )
             {
                 *Wp[from] = ( SUIT( *Wp[from] ) << 4 ) + RANK( *Wp[from] );
             }
+            hashpile( from );
 #if PRINT
             print_layout();
 #endif
@@ -6,7 +6,12 @@
 // freecell-solver
 #include "freecell-solver/fcs_user.h"
 // Qt
+#include <QDeadlineTimer>
 #include <QList>
+#include <QString>
+#include <QVector>
+// Std
+#include <atomic>
 
 
 /* A card is represented as ( down << 6 ) + (suit << 4) + rank. */
@@ -40,6 +45,7 @@ class SolverInterface {
 public:
     enum ExitStatus
     {
+        DeadlineReached = -4,
         MemoryLimitReached = -3,
         SearchAborted = -2,
         UnableToDetermineSolvability = -1,
@@ -47,16 +53,139 @@ public:
         SolutionExists = 1
     };
 
+    /* What the last patsolve() did. */
+    struct Stats
+    {
+        ExitStatus status = UnableToDetermineSolvability;
+        qint64 usecs = 0;                   /* wall time */
+        unsigned long moves = 0;            /* moves examined */
+        unsigned long generated = 0;        /* positions generated */
+        unsigned long positions = 0;        /* unique positions */
+        unsigned long compared = 0;         /* stored positions looked at as
+                                               their fingerprint matched a new
+                                               one's; most were the same */
+        unsigned long mismatched = 0;       /* of those, the ones that were
+                                               other positions after all */
+        unsigned long frontier = 0;         /* positions still queued at the end */
+        unsigned long peakFrontier = 0;     /* most positions queued at once */
+        size_t peakMemory = 0;              /* bytes, see setMemoryBudget() */
+        int piles = 0;                      /* distinct piles */
+        quint32 pileTableSize = 0;          /* slots of the pile table */
+        unsigned long spilled = 0;          /* positions kept on disk, see
+                                               setSpillDirectory() */
+        int config = -1;                    /* the portfolio configuration that
+                                               came to the conclusion, or -1 */
+        bool refuted = false;               /* lost by a quick look at the
+                                               layout, without a search */
+    };
+
     virtual ~SolverInterface() {};
     virtual ExitStatus patsolve( int max_positions = -1) = 0;
     virtual void translate_layout() = 0;
     virtual MoveHint translateMove(const MOVE &m ) = 0;
 
+    /* A search that is stopped, or runs out of time, keeps what it found
+    so far; the next patsolve() of the same layout goes on from there,
+    with as many threads as it had.  One with a position limit the kept
+    search is already past gives up at once and leaves it be. */
     virtual void stopExecution() = 0;
     virtual QList<MOVE> firstMoves() const = 0;
     virtual QList<MOVE> winMoves() const = 0;
+
+    /* The moves possible from the translated layout, best first.  This
+    does not search, so it is cheap enough for hints and autodrop. */
+    virtual QList<MOVE> legalMoves() = 0;
+
+    /* The search gives up (UnableToDetermineSolvability) once its position
+    store would grow beyond the budget, in bytes.  The peak is the most
+    memory the last patsolve() used; external solver libraries keep their
+    own memory and are not counted. */
+    virtual void setMemoryBudget(size_t bytes) = 0;
+    virtual size_t memoryBudget() const = 0;
+
+    /* Give up with DeadlineReached once the deadline has passed, or once a
+    single patsolve() has run for msecs; a negative time limit means none.
+    Whichever comes first counts.  Solver libraries are only stopped
+    between the chunks they search in. */
+    virtual void setDeadline(QDeadlineTimer deadline) = 0;
+    virtual void setTimeLimit(qint64 msecs) = 0;
+
+    /* Keep positions in huge pages where the system has them; worth it
+    for long batch searches.  Not to be called while a search runs. */
+    virtual void setLargePages(bool on) = 0;
+
+    /* Store most positions as their differences to the position they were
+    reached from.  That fits more positions in the memory budget, but they
+    take longer to compare and unpack.  Not to be called while a search runs. */
+    virtual void setCompactPositions(bool on) = 0;
+
+    /* Take positions that only differ in the order of piles the game
+    treats alike, such as the tableau columns of Yukon, for one.  That
+    makes the search space smaller, but few such positions meet in most
+    deals, and finding them costs time on every position.  Not to be
+    called while a search runs. */
+    virtual void setSymmetryReduction(bool on) = 0;
+
+    /* Keep the positions a search has seen by their 64 bit fingerprint
+    only, and let them spill to files in dir once they take more than a
+    sixteenth of the memory budget; Bloom filters of the spilled ones stay
+    in memory.  The budget is then mostly left for the positions still to
+    be searched, so searches get much further, at the price of slower
+    lookups.  For searches with one thread; an empty dir turns it off.
+    Not to be called while a search runs. */
+    virtual void setSpillDirectory(const QString &dir) = 0;
+
+    /* Let games with a small enough state, Aces Up and Golf so far, search
+    depth first on positions packed into 64 bits instead of the general
+    position store.  That is many times faster for the same moves, though
+    it may find other solutions.  It searches with one thread, ignores the
+    settings above, and a search it stops starts over the next time.
+    Other games search as usual.  Not to be called while a search runs. */
+    virtual void setDedicatedSearch(bool on) = 0;
+
+    /* Search a single deal with up to n threads, sharing the memory
+    budget.  Games whose solver cannot be copied search with one thread.
+    Which solution is found, if any, may then change from run to run. */
+    virtual void setThreads(int n) = 0;
+
+    /* Race up to n differently tuned copies of the search against each
+    other instead, one thread each, sharing the memory budget.  The first
+    conclusive result counts and stops the others; stats() tells which
+    configuration it was.  Configuration 0 is the solver's own.  As with
+    setThreads(), only games whose solver can be copied take part. */
+    virtual void setPortfolio(int n) = 0;
+
+    /* Save a search that stopped early to a file, and load one back, so
+    that the next patsolve() of the same layout goes on with it, possibly
+    in another process.  Only searches with one thread can be saved, and
+    they go on with one thread.  Loading needs the same game and the same
+    compact positions and symmetry settings, and replaces any search kept
+    so far.  Large pages may differ: a search saved with them, as
+    kpat --solve does, loads into a solver without, though each of its
+    blocks of positions then takes a block of its own as big as a large
+    page.  Both return false if that doesn't work out, or there is nothing
+    to save. */
+    virtual bool saveCheckpoint(const QString &fileName) = 0;
+    virtual bool loadCheckpoint(const QString &fileName) = 0;
+
+    /* The tuning of the search: the curve that squashes move priorities
+    into queues, followed by the game's own move priorities, if it has
+    any.  Empty for solvers that leave the search to a library.  Extra
+    values are ignored and missing ones keep their current value.  The
+    scenes load them from the solver parameter file, see kpat --tune. */
+    virtual QVector<qreal> parameters() const = 0;
+    virtual void setParameters(const QVector<qreal> &p) = 0;
+
+    virtual Stats stats() const = 0;
+
+    /* Single values of stats(), for the callers that only want one. */
+    size_t peakMemory() const { return stats().peakMemory; }
+    unsigned long frontierSize() const { return stats().frontier; }
+    unsigned long peakFrontier() const { return stats().peakFrontier; }
 };
 
-extern long all_moves;
+/* Moves examined by all solvers in this process; each solver adds its own
+count when a patsolve() run finishes. */
+extern std::atomic<long> all_moves;
 
 #endif
@@ -65,14 +65,14 @@ void SpiderSolver::make_move(MOVE *m)
             return;
         }
 	if (m->totype == O_Type) {
-            O[to] = SUIT( *Wp[from] );
+            O[to] = *Wp[from] & PS_SUIT;
             Wlen[from] -= 13;
             Wp[from] -= 13;
-            hashpile( from );
             if ( Wlen[from] && DOWN( *Wp[from] ) )
             {
                 *Wp[from] = ( SUIT( *Wp[from] ) << 4 ) + RANK( *Wp[from] );
             }
+            hashpile( from );
 #if PRINT
             print_layout();
 #endif
@@ -493,14 +493,12 @@ cannot_store_any_more_moves:
 
 void SpiderSolver::unpack_cluster( unsigned int k )
 {
-    // TODO: this only works for easy
-    for ( unsigned int i = 0; i < 8; ++i )
-    {
-        if ( i < k )
-            O[i] = PS_SPADE;
-        else
-            O[i] = -1;
-    }
+    int o = 0;
+    for ( int suit = 0; suit < 4; ++suit )
+        for ( unsigned int n = ( k >> ( suit * 4 ) ) & 0xF; n > 0; --n )
+            O[o++] = suit << 4;
+    while ( o < 8 )
+        O[o++] = -1;
 }
 
 bool SpiderSolver::isWon()
@@ -531,6 +529,11 @@ SpiderSolver::SpiderSolver(const Spider *dealer)
     deal = dealer;
 }
 
+SpiderSolver *SpiderSolver::clone() const
+{
+    return new SpiderSolver( *this );
+}
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
 card).  Temp cells and Out on the last two lines, if any. */
 
@@ -563,12 +566,16 @@ void SpiderSolver::translate_layout()
     }
 }
 
+/* The cluster counts the legs out of every suit, four bits each.  Which
+leg holds which suit only depends on the order they went out in, so
+that is left out. */
+
 unsigned int SpiderSolver::getClusterNumber()
 {
     unsigned int k = 0;
     for ( int i = 0; i < 8; ++i )
         if ( O[i] != -1 )
-            k++;
+            k += 1 << ( SUIT( O[i] ) * 4 );
     return k;
 }
 
@@ -597,6 +604,18 @@ void SpiderSolver::print_layout()
     return;
 }
 
+/* A redeal gives every column its own card, so the columns only become
+interchangeable once the redeals are all done. */
+
+const quint8 *SpiderSolver::pile_classes() const
+{
+    static const quint8 classes[15] = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+    for ( int i = 0; i < 5; ++i )
+        if ( Wlen[10+i] )
+            return nullptr;
+    return classes;
+}
+
 MoveHint SpiderSolver::translateMove( const MOVE &m )
 {
     if ( m.from >= 10 )
@@ -28,6 +28,7 @@ class SpiderSolver : public Solver</* 10 play + 5 redeals*/15>
 {
 public:
     explicit SpiderSolver(const Spider *dealer);
+    SpiderSolver *clone() const override;
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
     void make_move(MOVE *m) override;
@@ -36,6 +37,7 @@ public:
     unsigned int getClusterNumber() override;
     void translate_layout() override;
     void unpack_cluster( unsigned int k ) override;
+    const quint8 *pile_classes() const override;
     MoveHint translateMove(const MOVE &m) override;
 
     void print_layout() override;
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spillset.h"
+
+// Qt
+#include <QTemporaryFile>
+// Std
+#include <algorithm>
+#include <cstring>
+
+SpillSet::SpillSet(MemoryManager *account, const QString &dir)
+    : Account(account)
+    , Dir(dir)
+{
+	/* The newest fingerprints may take up to a sixteenth of the budget. */
+
+	Hotlimit = MIN_SLOTS;
+	while (Hotlimit * 2 * sizeof(quint64) <= Account->budget() / 16) {
+		Hotlimit *= 2;
+	}
+}
+
+SpillSet::~SpillSet()
+{
+	for (Run &run : Runs) {
+		free_run(&run);
+	}
+	if (Hot) {
+		Account->free_array(Hot, Hotsize);
+	}
+}
+
+/* Add a position to the set unless it's already there.  Like the visited
+set of a parallel search, two positions with the same fingerprint are
+taken for one. */
+
+MemoryManager::inscode SpillSet::visit(quint64 fp)
+{
+	size_t mask, i;
+
+	if (fp == 0) {
+		fp = 1;
+	}
+	if (Hot == nullptr) {
+		Hot = Account->new_array<quint64>(MIN_SLOTS);
+		if (Hot == nullptr) {
+			return MemoryManager::ERR;
+		}
+		Hotsize = MIN_SLOTS;
+	}
+
+	mask = Hotsize - 1;
+	for (i = fp & mask; Hot[i]; i = (i + 1) & mask) {
+		if (Hot[i] == fp) {
+			return MemoryManager::FOUND;
+		}
+	}
+	if (on_disk(fp)) {
+		return MemoryManager::FOUND;
+	}
+	Hot[i] = fp;
+
+	/* Keep the load factor below 3/4: grow the table while it may, and
+	spill it once it can't. */
+
+	if (++Hotused * 4 > Hotsize * 3 &&
+	    !(Hotsize < Hotlimit && grow()) && !spill()) {
+		return MemoryManager::ERR;
+	}
+	return MemoryManager::NEW;
+}
+
+bool SpillSet::on_disk(quint64 fp) const
+{
+	for (const Run &run : Runs) {
+		if (bloom_has(&run, fp) && std::binary_search(run.fps, run.fps + run.count, fp)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SpillSet::grow()
+{
+	quint64 *old = Hot;
+	size_t oldsize = Hotsize;
+	size_t mask, i, j;
+
+	quint64 *t = Account->new_array<quint64>(oldsize * 2);
+	if (t == nullptr) {
+		return false;
+	}
+	Hot = t;
+	Hotsize = oldsize * 2;
+	mask = Hotsize - 1;
+
+	for (i = 0; i < oldsize; ++i) {
+		if (old[i]) {
+			for (j = old[i] & mask; t[j]; j = (j + 1) & mask) {
+			}
+			t[j] = old[i];
+		}
+	}
+	Account->free_array(old, oldsize);
+
+	return true;
+}
+
+/* Write the fingerprints in the hash table to a new run, sorted, and
+empty the table.  They are sorted in place. */
+
+bool SpillSet::spill()
+{
+	size_t i, n = 0;
+	Run run;
+
+	for (i = 0; i < Hotsize; ++i) {
+		if (Hot[i]) {
+			Hot[n++] = Hot[i];
+		}
+	}
+	std::sort(Hot, Hot + n);
+
+	if (!new_run(&run, n)) {
+		return false;
+	}
+	for (i = 0; i < n; ++i) {
+		bloom_add(&run, Hot[i]);
+	}
+	if (run.file->write((const char *)Hot, n * sizeof(quint64)) != qint64(n * sizeof(quint64)) ||
+	    !map_run(&run)) {
+		free_run(&run);
+		return false;
+	}
+	memset(Hot, 0, Hotsize * sizeof(quint64));
+	Hotused = 0;
+	Spilled += n;
+	Runs.push_back(std::move(run));
+
+	return merge();
+}
+
+/* Merge the newest runs into one as long as FANIN of them have the same
+level.  They are disjoint, as nothing gets into the set twice. */
+
+bool SpillSet::merge()
+{
+	static constexpr size_t BUFSIZE = 8192;
+	std::vector<quint64> buf;
+	size_t at[FANIN];
+
+	while (Runs.size() >= FANIN) {
+		const size_t first = Runs.size() - FANIN;
+		size_t count = 0;
+		Run run;
+
+		for (size_t j = first; j < Runs.size(); ++j) {
+			if (Runs[j].level != Runs.back().level) {
+				return true;
+			}
+			count += Runs[j].count;
+		}
+		if (!new_run(&run, count)) {
+			return false;
+		}
+		run.level = Runs.back().level + 1;
+
+		std::fill(at, at + FANIN, 0);
+		buf.clear();
+		for (;;) {
+			int best = -1;
+			for (int j = 0; j < FANIN; ++j) {
+				const Run &r = Runs[first + j];
+				if (at[j] < r.count &&
+				    (best < 0 || r.fps[at[j]] < Runs[first + best].fps[at[best]])) {
+					best = j;
+				}
+			}
+			if (best >= 0) {
+				buf.push_back(Runs[first + best].fps[at[best]++]);
+				bloom_add(&run, buf.back());
+			}
+			if (buf.size() == BUFSIZE || (best < 0 && !buf.empty())) {
+				const qint64 bytes = buf.size() * sizeof(quint64);
+				if (run.file->write((const char *)buf.data(), bytes) != bytes) {
+					free_run(&run);
+					return false;
+				}
+				buf.clear();
+			}
+			if (best < 0) {
+				break;
+			}
+		}
+		if (!map_run(&run)) {
+			free_run(&run);
+			return false;
+		}
+
+		for (size_t j = first; j < Runs.size(); ++j) {
+			free_run(&Runs[j]);
+		}
+		Runs.resize(first);
+		Runs.push_back(std::move(run));
+	}
+	return true;
+}
+
+/* Start a run for count fingerprints: its file, and an empty Bloom
+filter of BLOOM_BITS bits per fingerprint or more. */
+
+bool SpillSet::new_run(Run *run, size_t count)
+{
+	run->file.reset(new QTemporaryFile(Dir + QLatin1String("/kpat-XXXXXX.visited")));
+	if (!run->file->open()) {
+		run->file.reset();
+		return false;
+	}
+	run->count = count;
+	run->bloombits = 64;
+	while (run->bloombits < count * BLOOM_BITS) {
+		run->bloombits *= 2;
+	}
+	run->bloom = Account->new_array<quint64>(run->bloombits / 64);
+	if (run->bloom == nullptr) {
+		run->file.reset();
+		return false;
+	}
+	return true;
+}
+
+/* Map the written file of a run, to search it. */
+
+bool SpillSet::map_run(Run *run)
+{
+	if (!run->file->flush()) {
+		return false;
+	}
+	run->fps = (const quint64 *)run->file->map(0, run->count * sizeof(quint64));
+	return run->fps != nullptr;
+}
+
+void SpillSet::free_run(Run *run)
+{
+	if (run->fps) {
+		run->file->unmap((uchar *)run->fps);
+		run->fps = nullptr;
+	}
+	if (run->bloom) {
+		Account->free_array(run->bloom, run->bloombits / 64);
+		run->bloom = nullptr;
+	}
+	run->file.reset();
+}
+
+/* The Bloom filters use double hashing; the fingerprints are random
+enough to be the hashes themselves. */
+
+void SpillSet::bloom_add(Run *run, quint64 fp)
+{
+	const quint64 step = (fp >> 32 | fp << 32) | 1;
+	const quint64 mask = run->bloombits - 1;
+	quint64 h = fp;
+
+	for (int k = 0; k < BLOOM_HASHES; ++k, h += step) {
+		run->bloom[(h & mask) >> 6] |= Q_UINT64_C(1) << (h & 63);
+	}
+}
+
+bool SpillSet::bloom_has(const Run *run, quint64 fp)
+{
+	const quint64 step = (fp >> 32 | fp << 32) | 1;
+	const quint64 mask = run->bloombits - 1;
+	quint64 h = fp;
+
+	for (int k = 0; k < BLOOM_HASHES; ++k, h += step) {
+		if (!(run->bloom[(h & mask) >> 6] & (Q_UINT64_C(1) << (h & 63)))) {
+			return false;
+		}
+	}
+	return true;
+}
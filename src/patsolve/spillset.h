@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPILLSET_H
+#define SPILLSET_H
+
+// own
+#include "memory.h"
+// Qt
+#include <QString>
+// Std
+#include <memory>
+#include <vector>
+
+class QTemporaryFile;
+
+/* A visited set that outgrows memory, for the searches of
+Solver::setSpillDirectory().  Positions are known by their fingerprint
+only.  The newest ones are in a hash table in memory; once that is full,
+it is sorted and written to a run file in the spill directory.  Every run
+has a Bloom filter in memory, so most lookups of new positions never
+touch the disk.  Runs of the same size are merged, FANIN at a time, which
+keeps their number logarithmic.  The files go away with the set. */
+
+class SpillSet
+{
+public:
+    SpillSet(MemoryManager *account, const QString &dir);
+    ~SpillSet();
+
+    MemoryManager::inscode visit(quint64 fp);
+    unsigned long spilled() const { return Spilled; }
+
+private:
+    struct Run {
+        std::unique_ptr<QTemporaryFile> file;
+        const quint64 *fps = nullptr;   /* sorted, mapped from the file */
+        size_t count = 0;
+        quint64 *bloom = nullptr;
+        size_t bloombits = 0;           /* a power of two */
+        int level = 0;                  /* runs merged into it, log FANIN */
+    };
+
+    static constexpr size_t MIN_SLOTS = 4096;       /* a power of two */
+    static constexpr int BLOOM_BITS = 16;           /* per fingerprint, at least */
+    static constexpr int BLOOM_HASHES = 8;
+    static constexpr int FANIN = 4;
+
+    bool on_disk(quint64 fp) const;
+    bool grow();
+    bool spill();
+    bool merge();
+    bool new_run(Run *run, size_t count);
+    bool map_run(Run *run);
+    void free_run(Run *run);
+    static void bloom_add(Run *run, quint64 fp);
+    static bool bloom_has(const Run *run, quint64 fp);
+
+    MemoryManager *Account;
+    QString Dir;
+    quint64 *Hot = nullptr;         /* open addressing, 0 is an empty slot */
+    size_t Hotsize = 0;             /* a power of two */
+    size_t Hotused = 0;
+    size_t Hotlimit;                /* the most slots Hot may have */
+    std::vector<Run> Runs;          /* the oldest first */
+    unsigned long Spilled = 0;
+};
+
+#endif // SPILLSET_H
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stateset.h"
+
+StateSet::StateSet(MemoryManager *account)
+    : Account(account)
+{
+}
+
+StateSet::~StateSet()
+{
+	if (Slots) {
+		Account->free_array(Slots, Size);
+	}
+}
+
+/* Packed positions are anything but random, so spread them over the
+table by Fibonacci hashing. */
+
+size_t StateSet::slot(quint64 key) const
+{
+	return (key * Q_UINT64_C(0x9E3779B97F4A7C15)) >> Shift;
+}
+
+/* Add a position to the set unless it's already there.  A key of 0 is
+taken for ~0, which no packed position uses. */
+
+MemoryManager::inscode StateSet::visit(quint64 key)
+{
+	size_t mask, i;
+
+	if (key == 0) {
+		key = ~Q_UINT64_C(0);
+	}
+	if (Slots == nullptr) {
+		Slots = Account->new_array<quint64>(MIN_SLOTS);
+		if (Slots == nullptr) {
+			return MemoryManager::ERR;
+		}
+		Size = MIN_SLOTS;
+		Shift = 64 - 12;
+	}
+
+	mask = Size - 1;
+	for (i = slot(key); Slots[i]; i = (i + 1) & mask) {
+		if (Slots[i] == key) {
+			return MemoryManager::FOUND;
+		}
+	}
+	Slots[i] = key;
+
+	/* Keep the load factor below 3/4. */
+
+	if (++Used * 4 > Size * 3 && !grow()) {
+		return MemoryManager::ERR;
+	}
+	return MemoryManager::NEW;
+}
+
+bool StateSet::grow()
+{
+	quint64 *old = Slots;
+	size_t oldsize = Size;
+	size_t mask, i, j;
+
+	quint64 *t = Account->new_array<quint64>(oldsize * 2);
+	if (t == nullptr) {
+		return false;
+	}
+	Slots = t;
+	Size = oldsize * 2;
+	Shift--;
+	mask = Size - 1;
+
+	for (i = 0; i < oldsize; ++i) {
+		if (old[i]) {
+			for (j = slot(old[i]); t[j]; j = (j + 1) & mask) {
+			}
+			t[j] = old[i];
+		}
+	}
+	Account->free_array(old, oldsize);
+
+	return true;
+}
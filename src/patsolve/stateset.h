@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 The KPat authors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATESET_H
+#define STATESET_H
+
+// own
+#include "memory.h"
+
+/* The visited set of a dedicated search, see
+Solver::setDedicatedSearch(): positions that are packed into 64 bits
+whole, or known by a 64 bit fingerprint.  It is a hash table with open
+addressing in the memory of the solver, so it counts against the budget. */
+
+class StateSet
+{
+public:
+    explicit StateSet(MemoryManager *account);
+    ~StateSet();
+
+    MemoryManager::inscode visit(quint64 key);
+    size_t size() const { return Used; }
+
+private:
+    static constexpr size_t MIN_SLOTS = 4096;       /* a power of two */
+
+    bool grow();
+    size_t slot(quint64 key) const;
+
+    MemoryManager *Account;
+    quint64 *Slots = nullptr;       /* 0 is an empty slot */
+    size_t Size = 0;                /* a power of two */
+    size_t Used = 0;
+    int Shift = 0;                  /* 64 - log2(Size) */
+};
+
+#endif // STATESET_H
@@ -348,6 +348,11 @@ YukonSolver::YukonSolver(const Yukon *dealer)
     deal = dealer;
 }
 
+YukonSolver *YukonSolver::clone() const
+{
+    return new YukonSolver( *this );
+}
+
 /* Read a layout file.  Format is one pile per line, bottom to top (visible
 card).  Temp cells and Out on the last two lines, if any. */
 
@@ -388,6 +393,19 @@ unsigned int YukonSolver::getClusterNumber()
     return k;
 }
 
+/* Any column can take what any other can, so their order doesn't matter. */
+
+const quint8 *YukonSolver::pile_classes() const
+{
+    static const quint8 classes[7] = { 1, 1, 1, 1, 1, 1, 1 };
+    return classes;
+}
+
+bool YukonSolver::dead_deal()
+{
+    return stuck_card(7);
+}
+
 MoveHint YukonSolver::translateMove( const MOVE &m )
 {
     PatPile *frompile = nullptr;
@@ -28,6 +28,7 @@ class YukonSolver : public Solver<7>
 {
 public:
     explicit YukonSolver(const Yukon *dealer);
+    YukonSolver *clone() const override;
     int good_automove(int o, int r);
     int get_possible_moves(int *a, int *numout) override;
     bool isWon() override;
@@ -37,6 +38,8 @@ public:
     unsigned int getClusterNumber() override;
     void translate_layout() override;
     void unpack_cluster( unsigned int k ) override;
+    bool dead_deal() override;
+    const quint8 *pile_classes() const override;
     MoveHint translateMove(const MOVE &m) override;
 
     void print_layout() override;
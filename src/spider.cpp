@@ -222,6 +222,9 @@ void Spider::setSuits(int suits)
         createDeck();
         deck()->setCardWidth( cardWidth );
 
+        // For the solver parameters of this variant.
+        setSolver( new SpiderSolver( this ) );
+
         Settings::setSpiderSuitCount( m_suits );
 
         if ( m_suits == 1 )